@@ -0,0 +1,47 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Bytes an allocation of the given size takes up in an arena */
+size_t arena_align(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+bool arena_init(Arena *arena, size_t size)
+{
+    size = arena_align(size);
+    arena->base = aligned_alloc(ARENA_ALIGNMENT, size > 0 ? size : ARENA_ALIGNMENT);
+    arena->size = size;
+    arena->used = 0;
+
+    if (!arena->base)
+        return false;
+
+    /* Zeroed so that arrays start out in a defined state */
+    memset(arena->base, 0, size);
+    return true;
+}
+
+/* Aligned space for count elements (zeroed only on first use after arena_init), or NULL if the arena is full */
+void *arena_alloc(Arena *arena, size_t count, size_t element_size)
+{
+    if (element_size != 0 && count > (arena->size - arena->used) / element_size)
+        return NULL;
+
+    size_t size = arena_align(count * element_size);
+    if (size > arena->size - arena->used)
+        return NULL;
+
+    void *memory = arena->base + arena->used;
+    arena->used += size;
+    return memory;
+}
+
+void arena_free(Arena *arena)
+{
+    free(arena->base);
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
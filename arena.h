@@ -0,0 +1,27 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Every allocation starts on this boundary so loops over arena arrays can use aligned vector loads */
+#define ARENA_ALIGNMENT 16
+
+/*
+ * Bump allocator over one block. The game sizes the block for all of its
+ * entity storage up front, so everything is allocated once at startup and
+ * released together.
+ */
+typedef struct
+{
+    char *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+size_t arena_align(size_t size);
+bool arena_init(Arena *arena, size_t size);
+void *arena_alloc(Arena *arena, size_t count, size_t element_size);
+void arena_free(Arena *arena);
+
+#endif
@@ -0,0 +1,480 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "terminal.h"
+#include "game.h"
+#include "snapshot.h"
+
+/* Benchmark settings */
+#define BENCH_WIDTH 120
+#define BENCH_HEIGHT 40
+#define BENCH_ITERATIONS 2000
+#define BENCH_CLEAR_ITERATIONS 100000
+#define BENCH_GAME_ITERATIONS 1000
+#define BENCH_REPEATS 5
+#define BENCH_STAR_COUNT 50
+
+/* Game benchmarks start from a fixed seed after this many scripted ticks */
+#define BENCH_SEED 1
+#define BENCH_TICK_RATE 30
+#define BENCH_WARMUP_TICKS 300
+#define BENCH_SWEEP_PERIOD 90
+#define BENCH_SPECIAL_PERIOD 300
+
+typedef enum
+{
+    FRAME_TYPICAL,
+    FRAME_WORST_CASE
+} FrameKind;
+
+typedef struct
+{
+    const char *label;
+    int enemies;
+    int bullets;
+} Density;
+
+static const Density densities[] = {
+    {"default", DEFAULT_MAX_ENEMIES, DEFAULT_MAX_BULLETS},
+    {"dense", 500, 1000},
+    {"stress", 5000, 10000},
+};
+
+/* A warmed-up game and a snapshot of it, so every repeat replays the same ticks */
+typedef struct
+{
+    Game game;
+    Snapshot *saved;
+    InputState input;
+    long tick;
+} BenchGame;
+
+/* Frames are written to STDOUT_FILENO (redirected to /dev/null), results go here */
+static FILE *results = NULL;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void fill_frame(TerminalBuffer *buf, FrameKind kind)
+{
+    terminal_buffer_clear(buf);
+
+    if (kind == FRAME_WORST_CASE)
+    {
+        /* A color change on every cell */
+        for (int y = 0; y < buf->height; y++)
+        {
+            for (int x = 0; x < buf->width; x++)
+                terminal_buffer_set_char(buf, x, y, 'A' + (x + y) % 26, TERM_PALETTE((x * 7 + y) % 256));
+        }
+        return;
+    }
+
+    /* Starfield, a formation and a HUD line, like a frame of the game */
+    srand(1);
+    for (int i = 0; i < BENCH_STAR_COUNT; i++)
+        terminal_buffer_set_char(buf, rand() % buf->width, rand() % (buf->height - 5), '.', COLOR_GRAY);
+
+    for (int row = 0; row < 5; row++)
+    {
+        for (int col = 0; col < 10; col++)
+            terminal_buffer_set_string(buf, 30 + col * 6, 3 + row * 3, "/X\\", row == 0 ? COLOR_RED : COLOR_MAGENTA);
+    }
+
+    terminal_buffer_set_string(buf, 2, 0, "LIVES: 3  HP: 3/3", COLOR_WHITE);
+    terminal_buffer_set_string(buf, 30, 0, "SCORE: 12345", COLOR_WHITE);
+}
+
+/* The original sprintf-based encoder, kept as the baseline to compare against */
+static int reference_encode(TerminalBuffer *buf, char *output_buffer)
+{
+    int pos = 0;
+    pos += sprintf(output_buffer + pos, "\033[1;1H");
+
+    uint8_t current_color = 255;
+    int safe_height = buf->height - 1;
+
+    for (int y = 0; y < safe_height; y++)
+    {
+        if (y > 0)
+            pos += sprintf(output_buffer + pos, "\033[%d;1H", y + 1);
+
+        for (int x = 0; x < buf->width; x++)
+        {
+            if (y == safe_height - 1 && x == buf->width - 1)
+                break;
+
+            const TerminalCell *cell = &buf->buffer[y * buf->width + x];
+            char ch = (char)cell->ch;
+            uint8_t color = (uint8_t)cell->fg;
+
+            if (color != current_color)
+            {
+                pos += sprintf(output_buffer + pos, "\033[38;5;%dm", color);
+                current_color = color;
+            }
+
+            output_buffer[pos++] = ch;
+        }
+    }
+
+    pos += sprintf(output_buffer + pos, "\033[0m");
+    return pos;
+}
+
+static void report(const char *name, double elapsed, long iterations, long long bytes)
+{
+    double ns_per_op = elapsed * 1e9 / iterations;
+    fprintf(results, "%-28s %10.0f ns/op %8lld bytes/op", name, ns_per_op, bytes / iterations);
+    if (bytes > 0)
+        fprintf(results, " %10.1f MB/s", bytes / elapsed / (1024.0 * 1024.0));
+    fputc('\n', results);
+}
+
+static void bench_flush(TerminalBuffer *buf, FrameKind kind, const char *label)
+{
+    static char reference_buffer[BENCH_WIDTH * BENCH_HEIGHT * 20];
+    char name[64];
+
+    fill_frame(buf, kind);
+
+    /* Baseline: sprintf per escape */
+    long long bytes = 0;
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        int length = reference_encode(buf, reference_buffer);
+        if (write(STDOUT_FILENO, reference_buffer, length) < 0)
+            break;
+        bytes += length;
+    }
+    snprintf(name, sizeof(name), "flush/%s/sprintf", label);
+    report(name, now_seconds() - start, BENCH_ITERATIONS, bytes);
+
+    /* Escape tables, full redraw every frame */
+    terminal_buffer_set_damage_tracking(buf, false);
+    bytes = 0;
+    start = now_seconds();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        terminal_buffer_flush(buf);
+        bytes += buf->flushed_bytes;
+    }
+    snprintf(name, sizeof(name), "flush/%s/table", label);
+    report(name, now_seconds() - start, BENCH_ITERATIONS, bytes);
+}
+
+static void bench_clear(TerminalBuffer *buf)
+{
+    double best = 0.0;
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_CLEAR_ITERATIONS; i++)
+            terminal_buffer_clear(buf);
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+            best = elapsed;
+    }
+    report("clear", best, BENCH_CLEAR_ITERATIONS, 0);
+}
+
+/* Sweep left and right while holding fire, with a special now and then; no bombs, so enemies stay on screen */
+static void bench_script_input(InputState *input, long tick)
+{
+    bool sweep_right = (tick % BENCH_SWEEP_PERIOD) < BENCH_SWEEP_PERIOD / 2;
+
+    memset(input, 0, sizeof(*input));
+    input->left = !sweep_right;
+    input->right = sweep_right;
+    input->shoot = true;
+    input->special = (tick % BENCH_SPECIAL_PERIOD) == 0;
+}
+
+static void bench_game_tick(BenchGame *bench)
+{
+    bench_script_input(&bench->input, bench->tick++);
+    game_update(&bench->game, &bench->input, 1.0f / BENCH_TICK_RATE);
+}
+
+static bool bench_game_create(BenchGame *bench, const Density *density)
+{
+    EntityCapacities capacities;
+    entity_capacities_default(&capacities);
+    capacities.enemies = density->enemies;
+    capacities.bullets = density->bullets;
+
+    if (!game_init(&bench->game, BENCH_WIDTH, BENCH_HEIGHT, &capacities, BENCH_SEED))
+        return false;
+
+    /* The player never dies, so every density keeps fighting for the whole run */
+    bench->game.player.god_mode = true;
+    bench->tick = 0;
+    for (int i = 0; i < BENCH_WARMUP_TICKS; i++)
+        bench_game_tick(bench);
+
+    bench->saved = snapshot_create(&bench->game);
+    if (!bench->saved)
+    {
+        game_free(&bench->game);
+        return false;
+    }
+    snapshot_capture(bench->saved, &bench->game);
+    return true;
+}
+
+static void bench_game_restore(BenchGame *bench)
+{
+    snapshot_restore(bench->saved, &bench->game);
+    bench->tick = BENCH_WARMUP_TICKS;
+}
+
+static void bench_game_destroy(BenchGame *bench)
+{
+    snapshot_destroy(bench->saved);
+    game_free(&bench->game);
+}
+
+/* The collision phase of game_update with hits detected but not resolved, so the state never changes */
+static int collision_pass(Game *game)
+{
+    BulletPool *bullets = &game->bullets;
+    EnemyPool *enemies = &game->formation.enemies;
+    int hits = 0;
+
+    collision_grid_build(&game->grid, enemies);
+
+    for (int d = bullets->count - 1; d >= 0; d--)
+    {
+        int i = bullets->dense[d];
+        if (bullets->info[i].is_player_bullet)
+        {
+            int candidate_count = collision_grid_query(&game->grid, collision_get_bullet_sweep_box(bullets, i),
+                                                       game->hit_candidates, enemies->capacity);
+            for (int c = 0; c < candidate_count; c++)
+            {
+                if (collision_enemy_bullet(enemies, game->hit_candidates[c], bullets, i))
+                    hits++;
+            }
+        }
+        else if (collision_player_bullet(&game->player, bullets, i))
+        {
+            hits++;
+        }
+    }
+
+    for (int i = enemy_next(enemies, 0); i < enemies->capacity; i = enemy_next(enemies, i + 1))
+    {
+        if (collision_player_enemy(&game->player, enemies, i))
+            hits++;
+    }
+
+    return hits;
+}
+
+static void bench_collision(BenchGame *bench, const char *label)
+{
+    char name[64];
+    double best = 0.0;
+    volatile int hits = 0;
+
+    bench_game_restore(bench);
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_ITERATIONS; i++)
+            hits += collision_pass(&bench->game);
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    snprintf(name, sizeof(name), "collision/%s", label);
+    report(name, best, BENCH_ITERATIONS, 0);
+}
+
+static void bench_formation(BenchGame *bench, const char *label)
+{
+    Game *game = &bench->game;
+    float dt = 1.0f / BENCH_TICK_RATE;
+    char name[64];
+    double best = 0.0;
+
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        bench_game_restore(bench);
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_GAME_ITERATIONS; i++)
+            enemy_ai_update_formation(&game->formation, dt, game->screen_width);
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    snprintf(name, sizeof(name), "formation/%s", label);
+    report(name, best, BENCH_GAME_ITERATIONS, 0);
+}
+
+/* Dives are triggered as in the game, otherwise the divers would all land within a few seconds */
+static void bench_dives(BenchGame *bench, const char *label)
+{
+    Game *game = &bench->game;
+    float dt = 1.0f / BENCH_TICK_RATE;
+    char name[64];
+    double best = 0.0;
+
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        bench_game_restore(bench);
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_GAME_ITERATIONS; i++)
+        {
+            enemy_ai_trigger_dive(&game->formation, dt, &game->player, game->screen_height, &game->rng);
+            enemy_ai_update_dives(&game->formation, dt, &game->player, game->screen_height);
+        }
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    snprintf(name, sizeof(name), "dives/%s", label);
+    report(name, best, BENCH_GAME_ITERATIONS, 0);
+}
+
+/* Taking and restoring a snapshot, which main.c does every few seconds for rewind */
+static void bench_snapshot(BenchGame *bench, const char *label)
+{
+    char name[64];
+    double best = 0.0;
+    long long bytes = (long long)bench->saved->size * BENCH_ITERATIONS;
+
+    /* Capturing the warmed-up state over itself leaves the snapshot as it was */
+    bench_game_restore(bench);
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_ITERATIONS; i++)
+            snapshot_capture(bench->saved, &bench->game);
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+            best = elapsed;
+    }
+    snprintf(name, sizeof(name), "snapshot/%s/capture", label);
+    report(name, best, BENCH_ITERATIONS, bytes);
+
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_ITERATIONS; i++)
+            bench_game_restore(bench);
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+            best = elapsed;
+    }
+    snprintf(name, sizeof(name), "snapshot/%s/restore", label);
+    report(name, best, BENCH_ITERATIONS, bytes);
+}
+
+/* One simulation tick alone, then a tick plus render and a damage-tracked flush, as main.c runs them */
+static void bench_frame(BenchGame *bench, TerminalBuffer *buf, const char *label)
+{
+    char name[64];
+    double best = 0.0;
+
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        bench_game_restore(bench);
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_GAME_ITERATIONS; i++)
+            bench_game_tick(bench);
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+            best = elapsed;
+    }
+    snprintf(name, sizeof(name), "frame/%s/update", label);
+    report(name, best, BENCH_GAME_ITERATIONS, 0);
+
+    terminal_buffer_set_damage_tracking(buf, true);
+    long long bytes = 0;
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        bench_game_restore(bench);
+        terminal_buffer_invalidate(buf);
+        long long repeat_bytes = 0;
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_GAME_ITERATIONS; i++)
+        {
+            bench_game_tick(bench);
+            terminal_buffer_clear(buf);
+            game_render(&bench->game, buf, 1.0f);
+            terminal_buffer_flush(buf);
+            repeat_bytes += buf->flushed_bytes;
+        }
+        double elapsed = now_seconds() - start;
+        if (repeat == 0 || elapsed < best)
+        {
+            best = elapsed;
+            bytes = repeat_bytes;
+        }
+    }
+    snprintf(name, sizeof(name), "frame/%s/full", label);
+    report(name, best, BENCH_GAME_ITERATIONS, bytes);
+}
+
+int main(void)
+{
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved_stdout < 0 || null_fd < 0)
+    {
+        fprintf(stderr, "Failed to open /dev/null.\n");
+        return 1;
+    }
+
+    fflush(stdout);
+    results = fdopen(saved_stdout, "w");
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    TerminalBuffer *buf = terminal_buffer_create(BENCH_WIDTH, BENCH_HEIGHT);
+    if (!buf || !results)
+    {
+        fprintf(stderr, "Failed to create terminal buffer.\n");
+        return 1;
+    }
+
+    bench_clear(buf);
+    bench_flush(buf, FRAME_TYPICAL, "typical");
+    bench_flush(buf, FRAME_WORST_CASE, "worst");
+
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++)
+    {
+        BenchGame bench;
+        if (!bench_game_create(&bench, &densities[d]))
+        {
+            fprintf(stderr, "Failed to allocate game state.\n");
+            terminal_buffer_destroy(buf);
+            return 1;
+        }
+
+        bench_collision(&bench, densities[d].label);
+        bench_formation(&bench, densities[d].label);
+        bench_dives(&bench, densities[d].label);
+        bench_frame(&bench, buf, densities[d].label);
+        bench_snapshot(&bench, densities[d].label);
+        bench_game_destroy(&bench);
+    }
+
+    terminal_buffer_destroy(buf);
+    fclose(results);
+    return 0;
+}
@@ -4,6 +4,28 @@
 #define BONUS_ENEMY_SPEED 20.0f
 #define SPAWN_INTERVAL 0.5f
 
+size_t bonus_stage_size(void)
+{
+    return enemy_pool_size(BONUS_ENEMIES);
+}
+
+bool bonus_stage_create(BonusStage *bonus, Arena *arena)
+{
+    *bonus = (BonusStage){0};
+    return enemy_pool_init(&bonus->enemies, BONUS_ENEMIES, arena);
+}
+
+/* Inactive, so the next bonus stage starts from scratch; keeps the enemy pool */
+void bonus_stage_reset(BonusStage *bonus)
+{
+    enemy_pool_clear(&bonus->enemies);
+    bonus->timer = 0.0f;
+    bonus->enemies_destroyed = 0;
+    bonus->active = false;
+    bonus->spawn_timer = 0.0f;
+    bonus->enemies_spawned = 0;
+}
+
 void bonus_stage_init(BonusStage *bonus, int screen_width)
 {
     bonus->timer = BONUS_STAGE_DURATION;
@@ -12,10 +34,7 @@ void bonus_stage_init(BonusStage *bonus, int screen_width)
     bonus->spawn_timer = 0.0f;
     bonus->enemies_spawned = 0;
 
-    for (int i = 0; i < BONUS_ENEMIES; i++)
-    {
-        bonus->enemies[i].active = false;
-    }
+    enemy_pool_clear(&bonus->enemies);
 
     (void)screen_width;
 }
@@ -32,34 +51,30 @@ void bonus_stage_update(BonusStage *bonus, float dt, int screen_width)
 
     if (bonus->spawn_timer <= 0.0f && bonus->enemies_spawned < BONUS_ENEMIES)
     {
-        Enemy *enemy = &bonus->enemies[bonus->enemies_spawned];
+        EnemyPool *enemies = &bonus->enemies;
+        int index = bonus->enemies_spawned;
 
         int side = bonus->enemies_spawned % 2;
         float start_x = (side == 0) ? 5.0f : screen_width - 5.0f;
         float start_y = 5.0f + (bonus->enemies_spawned / 2) * 2.0f;
 
-        enemy_init(enemy, ENEMY_BEE, bonus->enemies_spawned, start_x, start_y);
-        enemy->x = start_x;
-        enemy->y = start_y;
-        enemy->vx = (side == 0) ? BONUS_ENEMY_SPEED : -BONUS_ENEMY_SPEED;
-        enemy->vy = 0.0f;
+        enemy_init(enemies, index, ENEMY_BEE, index, start_x, start_y);
+        enemies->vx[index] = (side == 0) ? BONUS_ENEMY_SPEED : -BONUS_ENEMY_SPEED;
+        enemies->vy[index] = 0.0f;
 
         bonus->enemies_spawned++;
         bonus->spawn_timer = SPAWN_INTERVAL;
     }
 
-    for (int i = 0; i < BONUS_ENEMIES; i++)
+    EnemyPool *enemies = &bonus->enemies;
+    for (int i = enemy_next(enemies, 0); i < enemies->capacity; i = enemy_next(enemies, i + 1))
     {
-        Enemy *enemy = &bonus->enemies[i];
-        if (enemy->active)
-        {
-            enemy->x += enemy->vx * dt;
-            enemy->y = enemy->formation_y + sinf(enemy->x * 0.2f) * 3.0f;
+        enemies->x[i] += enemies->vx[i] * dt;
+        enemies->y[i] = enemies->formation_y[i] + sinf(enemies->x[i] * 0.2f) * 3.0f;
 
-            if (enemy->x < -5.0f || enemy->x > screen_width + 5.0f)
-            {
-                enemy->active = false;
-            }
+        if (enemies->x[i] < -5.0f || enemies->x[i] > screen_width + 5.0f)
+        {
+            enemy_deactivate(enemies, i);
         }
     }
 
@@ -9,7 +9,7 @@
 
 typedef struct
 {
-    Enemy enemies[BONUS_ENEMIES];
+    EnemyPool enemies;
     float timer;
     int enemies_destroyed;
     bool active;
@@ -17,6 +17,9 @@ typedef struct
     int enemies_spawned;
 } BonusStage;
 
+size_t bonus_stage_size(void);
+bool bonus_stage_create(BonusStage *bonus, Arena *arena);
+void bonus_stage_reset(BonusStage *bonus);
 void bonus_stage_init(BonusStage *bonus, int screen_width);
 void bonus_stage_update(BonusStage *bonus, float dt, int screen_width);
 bool bonus_stage_is_complete(BonusStage *bonus);
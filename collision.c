@@ -1,6 +1,22 @@
 #include "collision.h"
+#include <string.h>
 #include <math.h>
 
+/* Cells are larger than an enemy box, so a query only spans a few cells */
+#define GRID_CELL_SIZE 4.0f
+
+/*
+ * Extra columns and rows past the playfield, so positions up to width +
+ * reach (and height + reach) still map to cells of their own; lower
+ * coordinates, and anything further out, clamp to the edge cells. Building
+ * and querying clamp alike, so the margin only keeps edge cells short.
+ */
+#define GRID_MARGIN_CELLS 2
+
+/* Enemy box extends this far from its position in any direction */
+#define ENEMY_REACH_X 3.0f
+#define ENEMY_REACH_Y 2.0f
+
 bool collision_check_aabb(BoundingBox a, BoundingBox b)
 {
     return (a.x < b.x + b.width && a.x + a.width > b.x && a.y < b.y + b.height && a.y + a.height > b.y);
@@ -11,6 +27,63 @@ bool collision_check_point_box(float px, float py, BoundingBox box)
     return (px >= box.x && px < box.x + box.width && py >= box.y && py < box.y + box.height);
 }
 
+/* Whether the segment from (x0, y0) to (x1, y1) passes through the open box (slab test) */
+bool collision_check_segment_box(float x0, float y0, float x1, float y1, BoundingBox box)
+{
+    float start[2] = {x0, y0};
+    float delta[2] = {x1 - x0, y1 - y0};
+    float low[2] = {box.x, box.y};
+    float high[2] = {box.x + box.width, box.y + box.height};
+
+    float t_enter = 0.0f;
+    float t_exit = 1.0f;
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (delta[axis] == 0.0f)
+        {
+            /* Parallel to this slab: must already be inside it */
+            if (start[axis] <= low[axis] || start[axis] >= high[axis])
+                return false;
+            continue;
+        }
+
+        float t_low = (low[axis] - start[axis]) / delta[axis];
+        float t_high = (high[axis] - start[axis]) / delta[axis];
+        if (t_low > t_high)
+        {
+            float swap = t_low;
+            t_low = t_high;
+            t_high = swap;
+        }
+
+        if (t_low > t_enter)
+            t_enter = t_low;
+        if (t_high < t_exit)
+            t_exit = t_high;
+        if (t_enter >= t_exit)
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Whether a box moving by (dx, dy) touches the target at any point along the
+ * way. The target is grown by the moving box's size so the test reduces to a
+ * segment traced by the moving box's corner.
+ */
+bool collision_check_swept_aabb(BoundingBox moving, float dx, float dy, BoundingBox target)
+{
+    BoundingBox expanded;
+    expanded.x = target.x - moving.width;
+    expanded.y = target.y - moving.height;
+    expanded.width = target.width + moving.width;
+    expanded.height = target.height + moving.height;
+
+    return collision_check_segment_box(moving.x, moving.y, moving.x + dx, moving.y + dy, expanded);
+}
+
 BoundingBox collision_get_player_box(Player *player)
 {
     BoundingBox box;
@@ -21,26 +94,61 @@ BoundingBox collision_get_player_box(Player *player)
     return box;
 }
 
-BoundingBox collision_get_enemy_box(Enemy *enemy)
+BoundingBox collision_get_enemy_box(EnemyPool *enemies, int index)
 {
     BoundingBox box;
-    box.x = enemy->x - 1.0f;
-    box.y = enemy->y - 1.0f;
+    box.x = enemies->x[index] - 1.0f;
+    box.y = enemies->y[index] - 1.0f;
     box.width = 3.0f;
     box.height = 2.0f;
     return box;
 }
 
-BoundingBox collision_get_bullet_box(Bullet *bullet)
+BoundingBox collision_get_bullet_box(BulletPool *bullets, int index)
 {
     BoundingBox box;
-    box.x = bullet->x;
-    box.y = bullet->y;
+    box.x = bullets->x[index];
+    box.y = bullets->y[index];
     box.width = 1.0f;
     box.height = 1.0f;
     return box;
 }
 
+/* Box covering the bullet's path over the last tick */
+BoundingBox collision_get_bullet_sweep_box(BulletPool *bullets, int index)
+{
+    float x = bullets->x[index];
+    float y = bullets->y[index];
+    float prev_x = bullets->prev_x[index];
+    float prev_y = bullets->prev_y[index];
+
+    BoundingBox box;
+    box.x = fminf(prev_x, x);
+    box.y = fminf(prev_y, y);
+    box.width = fabsf(x - prev_x) + 1.0f;
+    box.height = fabsf(y - prev_y) + 1.0f;
+    return box;
+}
+
+/* Bullet box at the start of the tick, for swept tests */
+static BoundingBox collision_get_bullet_start_box(BulletPool *bullets, int index)
+{
+    BoundingBox box = collision_get_bullet_box(bullets, index);
+    box.x = bullets->prev_x[index];
+    box.y = bullets->prev_y[index];
+    return box;
+}
+
+/* Swept test of a bullet's movement over the last tick against a box */
+static bool collision_bullet_sweep_hits(BulletPool *bullets, int index, BoundingBox target)
+{
+    BoundingBox bullet_box = collision_get_bullet_start_box(bullets, index);
+    float dx = bullets->x[index] - bullets->prev_x[index];
+    float dy = bullets->y[index] - bullets->prev_y[index];
+
+    return collision_check_swept_aabb(bullet_box, dx, dy, target);
+}
+
 BoundingBox collision_get_powerup_box(PowerUp *powerup)
 {
     BoundingBox box;
@@ -51,41 +159,37 @@ BoundingBox collision_get_powerup_box(PowerUp *powerup)
     return box;
 }
 
-bool collision_player_bullet(Player *player, Bullet *bullet)
+bool collision_player_bullet(Player *player, BulletPool *bullets, int index)
 {
-    if (bullet->is_player_bullet || !bullet->active)
+    if (bullets->info[index].is_player_bullet || !bullet_is_active(bullets, index))
     {
         return false;
     }
 
-    BoundingBox player_box = collision_get_player_box(player);
-    BoundingBox bullet_box = collision_get_bullet_box(bullet);
-
-    return collision_check_aabb(player_box, bullet_box);
+    /* Swept so fast bullets cannot pass through the player between ticks */
+    return collision_bullet_sweep_hits(bullets, index, collision_get_player_box(player));
 }
 
-bool collision_enemy_bullet(Enemy *enemy, Bullet *bullet)
+bool collision_enemy_bullet(EnemyPool *enemies, int enemy, BulletPool *bullets, int bullet)
 {
-    if (!bullet->is_player_bullet || !bullet->active || !enemy->active)
+    if (!bullets->info[bullet].is_player_bullet || !bullet_is_active(bullets, bullet) ||
+        !enemy_is_active(enemies, enemy))
     {
         return false;
     }
 
-    BoundingBox enemy_box = collision_get_enemy_box(enemy);
-    BoundingBox bullet_box = collision_get_bullet_box(bullet);
-
-    return collision_check_aabb(enemy_box, bullet_box);
+    return collision_bullet_sweep_hits(bullets, bullet, collision_get_enemy_box(enemies, enemy));
 }
 
-bool collision_player_enemy(Player *player, Enemy *enemy)
+bool collision_player_enemy(Player *player, EnemyPool *enemies, int index)
 {
-    if (!enemy->active)
+    if (!enemy_is_active(enemies, index))
     {
         return false;
     }
 
     BoundingBox player_box = collision_get_player_box(player);
-    BoundingBox enemy_box = collision_get_enemy_box(enemy);
+    BoundingBox enemy_box = collision_get_enemy_box(enemies, index);
 
     return collision_check_aabb(player_box, enemy_box);
 }
@@ -102,3 +206,115 @@ bool collision_player_powerup(Player *player, PowerUp *powerup)
 
     return collision_check_aabb(player_box, powerup_box);
 }
+
+static int grid_cols(int width)
+{
+    /* Enemies dive past the screen edges; anything outside lands in the border cells */
+    return (int)ceilf(width / GRID_CELL_SIZE) + GRID_MARGIN_CELLS;
+}
+
+static int grid_rows(int height)
+{
+    return (int)ceilf(height / GRID_CELL_SIZE) + GRID_MARGIN_CELLS;
+}
+
+/* Arena space taken by a grid for the given playfield and enemy capacity */
+size_t collision_grid_size(int width, int height, int capacity)
+{
+    int cells = grid_cols(width) * grid_rows(height);
+    return arena_align((cells + 1) * sizeof(int)) + arena_align(cells * sizeof(int)) +
+           2 * arena_align(capacity * sizeof(int));
+}
+
+bool collision_grid_init(CollisionGrid *grid, int width, int height, int capacity, Arena *arena)
+{
+    grid->cols = grid_cols(width);
+    grid->rows = grid_rows(height);
+    grid->capacity = capacity;
+
+    int cells = grid->cols * grid->rows;
+    grid->cell_start = arena_alloc(arena, cells + 1, sizeof(int));
+    grid->cell_fill = arena_alloc(arena, cells, sizeof(int));
+    grid->entries = arena_alloc(arena, capacity, sizeof(int));
+    grid->entry_cell = arena_alloc(arena, capacity, sizeof(int));
+
+    return grid->cell_start && grid->cell_fill && grid->entries && grid->entry_cell;
+}
+
+static int grid_clamp(int value, int max)
+{
+    if (value < 0)
+        return 0;
+    if (value >= max)
+        return max - 1;
+    return value;
+}
+
+static int grid_col(CollisionGrid *grid, float x)
+{
+    return grid_clamp((int)floorf(x / GRID_CELL_SIZE), grid->cols);
+}
+
+static int grid_row(CollisionGrid *grid, float y)
+{
+    return grid_clamp((int)floorf(y / GRID_CELL_SIZE), grid->rows);
+}
+
+/* Bucket active enemies by cell with a counting sort */
+void collision_grid_build(CollisionGrid *grid, EnemyPool *enemies)
+{
+    int cells = grid->cols * grid->rows;
+    int count = enemies->capacity;
+    if (count > grid->capacity)
+        count = grid->capacity;
+
+    memset(grid->cell_start, 0, (cells + 1) * sizeof(int));
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!enemy_is_active(enemies, i))
+        {
+            grid->entry_cell[i] = -1;
+            continue;
+        }
+
+        int cell = grid_row(grid, enemies->y[i]) * grid->cols + grid_col(grid, enemies->x[i]);
+        grid->entry_cell[i] = cell;
+        grid->cell_start[cell + 1]++;
+    }
+
+    for (int c = 0; c < cells; c++)
+    {
+        grid->cell_start[c + 1] += grid->cell_start[c];
+        grid->cell_fill[c] = grid->cell_start[c];
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int cell = grid->entry_cell[i];
+        if (cell >= 0)
+            grid->entries[grid->cell_fill[cell]++] = i;
+    }
+}
+
+/* Collect enemies whose box may overlap the given box; returns the number written to out */
+int collision_grid_query(CollisionGrid *grid, BoundingBox box, int *out, int max_out)
+{
+    int col_min = grid_col(grid, box.x - ENEMY_REACH_X);
+    int col_max = grid_col(grid, box.x + box.width + ENEMY_REACH_X);
+    int row_min = grid_row(grid, box.y - ENEMY_REACH_Y);
+    int row_max = grid_row(grid, box.y + box.height + ENEMY_REACH_Y);
+
+    int found = 0;
+    for (int row = row_min; row <= row_max; row++)
+    {
+        for (int col = col_min; col <= col_max; col++)
+        {
+            int cell = row * grid->cols + col;
+            for (int e = grid->cell_start[cell]; e < grid->cell_start[cell + 1] && found < max_out; e++)
+                out[found++] = grid->entries[e];
+        }
+    }
+
+    return found;
+}
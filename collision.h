@@ -10,17 +10,37 @@ typedef struct
     float width, height;
 } BoundingBox;
 
+/* Uniform grid broadphase over enemy positions, rebuilt every tick */
+typedef struct
+{
+    int cols;
+    int rows;
+    int capacity;    /* Maximum number of enemies */
+    int *cell_start; /* cols * rows + 1 offsets into entries */
+    int *cell_fill;  /* Insertion cursor per cell while building */
+    int *entries;    /* Enemy indices grouped by cell */
+    int *entry_cell; /* Cell of each enemy, -1 if inactive */
+} CollisionGrid;
+
 bool collision_check_aabb(BoundingBox a, BoundingBox b);
 bool collision_check_point_box(float px, float py, BoundingBox box);
+bool collision_check_segment_box(float x0, float y0, float x1, float y1, BoundingBox box);
+bool collision_check_swept_aabb(BoundingBox moving, float dx, float dy, BoundingBox target);
 
 BoundingBox collision_get_player_box(Player *player);
-BoundingBox collision_get_enemy_box(Enemy *enemy);
-BoundingBox collision_get_bullet_box(Bullet *bullet);
+BoundingBox collision_get_enemy_box(EnemyPool *enemies, int index);
+BoundingBox collision_get_bullet_box(BulletPool *bullets, int index);
+BoundingBox collision_get_bullet_sweep_box(BulletPool *bullets, int index);
 BoundingBox collision_get_powerup_box(PowerUp *powerup);
 
-bool collision_player_bullet(Player *player, Bullet *bullet);
-bool collision_enemy_bullet(Enemy *enemy, Bullet *bullet);
-bool collision_player_enemy(Player *player, Enemy *enemy);
+bool collision_player_bullet(Player *player, BulletPool *bullets, int index);
+bool collision_enemy_bullet(EnemyPool *enemies, int enemy, BulletPool *bullets, int bullet);
+bool collision_player_enemy(Player *player, EnemyPool *enemies, int index);
 bool collision_player_powerup(Player *player, PowerUp *powerup);
 
+size_t collision_grid_size(int width, int height, int capacity);
+bool collision_grid_init(CollisionGrid *grid, int width, int height, int capacity, Arena *arena);
+void collision_grid_build(CollisionGrid *grid, EnemyPool *enemies);
+int collision_grid_query(CollisionGrid *grid, BoundingBox box, int *out, int max_out);
+
 #endif
@@ -0,0 +1,155 @@
+#include "dive_path.h"
+#include <math.h>
+
+/* Curve pieces evaluated between each pair of control points while measuring arc length */
+#define DIVE_PATH_SUBDIVISIONS 32
+#define DIVE_PATH_MAX_POINTS 16
+#define DIVE_PATH_DENSE_POINTS ((DIVE_PATH_MAX_POINTS - 1) * DIVE_PATH_SUBDIVISIONS + 1)
+
+/* Control point: x in cells on an 80-column screen, depth as in DivePath */
+typedef struct
+{
+    float x;
+    float depth;
+} DivePoint;
+
+typedef struct
+{
+    const DivePoint *points;
+    int count;
+} DiveShape;
+
+/* Peel off upward, turn a full loop, then weave down onto the player */
+static const DivePoint loop_points[] = {
+    {0.0f, 0.0f},  {2.0f, -0.12f}, {5.0f, -0.18f}, {8.0f, -0.08f}, {8.0f, 0.08f}, {5.0f, 0.16f},
+    {2.0f, 0.1f},  {1.0f, 0.3f},   {3.0f, 0.55f},  {1.0f, 0.8f},   {0.0f, 1.0f},  {0.0f, 1.4f},
+};
+
+/* Hop up, then swing from side to side all the way down */
+static const DivePoint zigzag_points[] = {
+    {0.0f, 0.0f},  {3.0f, -0.08f}, {6.0f, 0.1f}, {-3.0f, 0.3f}, {6.0f, 0.5f},
+    {-3.0f, 0.7f}, {2.0f, 0.88f},  {0.0f, 1.0f}, {0.0f, 1.4f},
+};
+
+/* A wide arc out to the side that comes back in under the player */
+static const DivePoint sweep_points[] = {
+    {0.0f, 0.0f}, {4.0f, -0.1f}, {12.0f, 0.1f}, {16.0f, 0.4f}, {12.0f, 0.7f}, {4.0f, 0.9f}, {0.0f, 1.0f}, {-4.0f, 1.4f},
+};
+
+/* The boss drops straight onto the player, slowing through the attack row to hold its tractor beam there */
+static const DivePoint capture_points[] = {
+    {0.0f, 0.0f}, {2.0f, -0.1f}, {5.0f, 0.1f}, {3.0f, 0.45f}, {0.0f, 0.8f}, {0.0f, 1.0f}, {0.0f, 1.05f}, {0.0f, 1.4f},
+};
+
+static const DiveShape shapes[DIVE_PATTERN_COUNT] = {
+    [DIVE_PATTERN_LOOP] = {loop_points, sizeof(loop_points) / sizeof(loop_points[0])},
+    [DIVE_PATTERN_ZIGZAG] = {zigzag_points, sizeof(zigzag_points) / sizeof(zigzag_points[0])},
+    [DIVE_PATTERN_SWEEP] = {sweep_points, sizeof(sweep_points) / sizeof(sweep_points[0])},
+    [DIVE_PATTERN_CAPTURE] = {capture_points, sizeof(capture_points) / sizeof(capture_points[0])},
+};
+
+/* Control point i, extending the curve past either end by mirroring the neighbouring point */
+static DivePoint shape_point(const DiveShape *shape, int i)
+{
+    if (i < 0)
+        return (DivePoint){2.0f * shape->points[0].x - shape->points[1].x,
+                           2.0f * shape->points[0].depth - shape->points[1].depth};
+    if (i >= shape->count)
+    {
+        const DivePoint *last = &shape->points[shape->count - 1];
+        const DivePoint *before = &shape->points[shape->count - 2];
+        return (DivePoint){2.0f * last->x - before->x, 2.0f * last->depth - before->depth};
+    }
+    return shape->points[i];
+}
+
+/* Uniform Catmull-Rom spline through p1 and p2 */
+static float catmull_rom(float p0, float p1, float p2, float p3, float t)
+{
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t * t +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * t * t * t);
+}
+
+/*
+ * Evaluate the spline densely in screen cells, then resample it at even
+ * distances along the curve so enemies move at a steady speed through
+ * loops and straights alike.
+ */
+static void dive_path_bake(DivePath *path, const DiveShape *shape, float width_scale, float depth_cells)
+{
+    float dense_x[DIVE_PATH_DENSE_POINTS];
+    float dense_y[DIVE_PATH_DENSE_POINTS];
+    float distance[DIVE_PATH_DENSE_POINTS];
+    int dense_count = 0;
+
+    for (int segment = 0; segment < shape->count - 1; segment++)
+    {
+        DivePoint p0 = shape_point(shape, segment - 1);
+        DivePoint p1 = shape_point(shape, segment);
+        DivePoint p2 = shape_point(shape, segment + 1);
+        DivePoint p3 = shape_point(shape, segment + 2);
+
+        /* The last segment also takes its end point */
+        int steps = segment == shape->count - 2 ? DIVE_PATH_SUBDIVISIONS + 1 : DIVE_PATH_SUBDIVISIONS;
+        for (int s = 0; s < steps; s++)
+        {
+            float t = (float)s / DIVE_PATH_SUBDIVISIONS;
+            dense_x[dense_count] = catmull_rom(p0.x, p1.x, p2.x, p3.x, t) * width_scale;
+            dense_y[dense_count] = catmull_rom(p0.depth, p1.depth, p2.depth, p3.depth, t) * depth_cells;
+            dense_count++;
+        }
+    }
+
+    distance[0] = 0.0f;
+    for (int i = 1; i < dense_count; i++)
+    {
+        float dx = dense_x[i] - dense_x[i - 1];
+        float dy = dense_y[i] - dense_y[i - 1];
+        distance[i] = distance[i - 1] + sqrtf(dx * dx + dy * dy);
+    }
+
+    path->length = distance[dense_count - 1];
+    path->step = path->length / (DIVE_PATH_SAMPLES - 1);
+
+    int j = 0;
+    for (int s = 0; s < DIVE_PATH_SAMPLES; s++)
+    {
+        float target = s * path->step;
+        while (j < dense_count - 2 && distance[j + 1] < target)
+            j++;
+
+        float span = distance[j + 1] - distance[j];
+        float f = span > 0.0f ? (target - distance[j]) / span : 0.0f;
+        if (f > 1.0f)
+            f = 1.0f;
+
+        path->x[s] = dense_x[j] + (dense_x[j + 1] - dense_x[j]) * f;
+        path->depth[s] = (dense_y[j] + (dense_y[j + 1] - dense_y[j]) * f) / depth_cells;
+    }
+}
+
+/* Bake every pattern for a playfield; width_scale is its width over 80 columns */
+void dive_path_bake_all(DivePath paths[DIVE_PATTERN_COUNT], float width_scale, float depth_cells)
+{
+    if (depth_cells < 1.0f)
+        depth_cells = 1.0f;
+
+    for (int p = 0; p < DIVE_PATTERN_COUNT; p++)
+        dive_path_bake(&paths[p], &shapes[p], width_scale, depth_cells);
+}
+
+/* Position distance cells along the path, or false once the path has been run to its end */
+bool dive_path_sample(const DivePath *path, float distance, float *x, float *depth, int *index)
+{
+    float position = distance / path->step;
+    if (position >= DIVE_PATH_SAMPLES - 1)
+        return false;
+
+    int k = (int)position;
+    float f = position - k;
+
+    *x = path->x[k] + (path->x[k + 1] - path->x[k]) * f;
+    *depth = path->depth[k] + (path->depth[k + 1] - path->depth[k]) * f;
+    *index = k;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef DIVE_PATH_H
+#define DIVE_PATH_H
+
+#include <stdbool.h>
+
+/* Samples per baked path, evenly spaced along the curve */
+#define DIVE_PATH_SAMPLES 128
+
+typedef enum
+{
+    DIVE_PATTERN_LOOP,
+    DIVE_PATTERN_ZIGZAG,
+    DIVE_PATTERN_SWEEP,
+    DIVE_PATTERN_CAPTURE,
+    DIVE_PATTERN_COUNT
+} DivePattern;
+
+/*
+ * A dive curve baked for the current playfield. x is the horizontal offset
+ * in cells from where the dive began, to be mirrored by the dive direction;
+ * depth runs from 0 at the start to 1 at the attack row, and past 1 as the
+ * enemy leaves the bottom of the screen. Consecutive samples are step cells
+ * apart along the curve, so advancing at a fixed speed is a fixed rate
+ * through the table.
+ */
+typedef struct
+{
+    float x[DIVE_PATH_SAMPLES];
+    float depth[DIVE_PATH_SAMPLES];
+    float step;
+    float length;
+} DivePath;
+
+void dive_path_bake_all(DivePath paths[DIVE_PATTERN_COUNT], float width_scale, float depth_cells);
+bool dive_path_sample(const DivePath *path, float distance, float *x, float *depth, int *index);
+
+#endif
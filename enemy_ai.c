@@ -1,18 +1,125 @@
 #include "enemy_ai.h"
-#include <stdlib.h>
 #include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define FORMATION_SPACING_X 6.0f
 #define FORMATION_SPACING_Y 3.0f
 #define FORMATION_START_Y 3.0f
 #define FORMATION_MOVE_SPEED 15.0f
-#define DIVE_SPEED 25.0f
+#define DIVE_SPEED 25.0f /* Cells per second along the dive path */
+#define DIVE_ATTACK_ROW_OFFSET 5.0f
+#define DIVE_CAPTURE_RANGE 2.0f
+#define RETURN_RATE 2.0f /* Decay rate per second of the distance left to the formation slot */
+#define DIVE_REFERENCE_WIDTH 80.0f /* Screen width the dive shapes were drawn for */
 #define DIVE_INTERVAL_BASE 3.0f
 #define CAPTURE_INTERVAL 15.0f
 
-static void create_dive_path(Enemy *enemy, float target_x, float target_y, int pattern);
+/* Formations larger than FORMATION_COLS x FORMATION_ROWS squeeze into this part of the playfield */
+#define FORMATION_MARGIN_X 2.0f
+#define FORMATION_MAX_HEIGHT_FRACTION 0.5f
+
+/* Side-to-side sway of enemies in formation, and the bob of the whole formation */
+#define FORMATION_SWAY_FREQUENCY 0.5f
+#define FORMATION_SWAY_PHASE_RATE 0.1f
+#define FORMATION_SWAY_AMPLITUDE 1.5f
+#define FORMATION_BOB_RATE 0.3f
+#define FORMATION_BOB_AMPLITUDE 0.5f
+
+/* Lanes handled per step by the formation kernel */
+#define FORMATION_LANES 4
+
+/* Arena space taken by a formation of the given capacity */
+size_t enemy_ai_formation_size(int capacity)
+{
+    return enemy_pool_size(capacity) + arena_align(capacity * sizeof(int)) +
+           arena_align(POOL_MASK_WORDS(capacity) * sizeof(uint64_t)) + 2 * arena_align(capacity * sizeof(float)) +
+           arena_align(DIVE_PATTERN_COUNT * sizeof(DivePath));
+}
+
+/*
+ * The sway tables come from the arena, so like the pool arrays they are
+ * 16-byte aligned and padded to a whole number of FORMATION_LANES floats.
+ */
+bool enemy_ai_formation_create(EnemyFormation *formation, int capacity, Arena *arena)
+{
+    *formation = (EnemyFormation){0};
+    formation->dive_candidates = arena_alloc(arena, capacity, sizeof(int));
+    formation->in_formation = arena_alloc(arena, POOL_MASK_WORDS(capacity), sizeof(uint64_t));
+    formation->sway_sin = arena_alloc(arena, capacity, sizeof(float));
+    formation->sway_cos = arena_alloc(arena, capacity, sizeof(float));
+    formation->dive_paths = arena_alloc(arena, DIVE_PATTERN_COUNT, sizeof(DivePath));
+    return formation->dive_candidates && formation->in_formation && formation->sway_sin && formation->sway_cos &&
+           formation->dive_paths && enemy_pool_init(&formation->enemies, capacity, arena);
+}
+
+/* Change an enemy's state, keeping the in_formation mask in step */
+static void set_state(EnemyFormation *formation, int index, EnemyState state)
+{
+    formation->enemies.info[index].state = state;
+    if (state == ENEMY_STATE_FORMATION)
+        pool_mask_set(formation->in_formation, index);
+    else
+        pool_mask_clear(formation->in_formation, index);
+}
+
+/* Send an enemy down a dive path from where it is now, curving toward the player's side */
+static void start_dive(EnemyFormation *formation, int index, const Player *player, DivePattern pattern)
+{
+    EnemyPool *enemies = &formation->enemies;
+    EnemyInfo *info = &enemies->info[index];
+
+    set_state(formation, index, ENEMY_STATE_DIVING);
+    info->dive_timer = 0.0f;
+    info->dive_path_index = 0;
+    info->dive_pattern = pattern;
+    info->dive_direction = enemies->x[index] < player->x ? 1.0f : -1.0f;
+    info->dive_origin_x = enemies->x[index];
+    info->dive_origin_y = enemies->y[index];
+}
 
-void enemy_ai_init_formation(EnemyFormation *formation, int screen_width, int wave)
+/*
+ * The classic 10x5 grid when the enemies fit in it. Larger formations use as
+ * many columns as fit across the playfield and enough rows for the rest,
+ * shrinking the row spacing so they stay in the top half of the screen.
+ */
+static void formation_layout(int capacity, int screen_width, int screen_height, int *cols, float *spacing_y)
+{
+    *cols = FORMATION_COLS;
+    *spacing_y = FORMATION_SPACING_Y;
+
+    if (capacity <= FORMATION_COLS * FORMATION_ROWS)
+        return;
+
+    float usable_width = screen_width - 2.0f * FORMATION_MARGIN_X;
+    float usable_height = screen_height * FORMATION_MAX_HEIGHT_FRACTION - FORMATION_START_Y;
+
+    int fitting_cols = (int)(usable_width / FORMATION_SPACING_X);
+    if (fitting_cols > *cols)
+        *cols = fitting_cols;
+
+    int rows = (capacity + *cols - 1) / *cols;
+    if (rows * FORMATION_SPACING_Y > usable_height && usable_height > 0.0f)
+        *spacing_y = usable_height / rows;
+}
+
+/* Empty formation with no wave in progress; keeps the enemy pool */
+void enemy_ai_reset_formation(EnemyFormation *formation)
+{
+    enemy_pool_clear(&formation->enemies);
+    memset(formation->in_formation, 0, POOL_MASK_WORDS(formation->enemies.capacity) * sizeof(uint64_t));
+    formation->active_count = 0;
+    formation->formation_offset_x = 0.0f;
+    formation->formation_direction = 0.0f;
+    formation->dive_spawn_timer = 0.0f;
+    formation->capture_beam_timer = 0.0f;
+    formation->difficulty_level = 0;
+}
+
+void enemy_ai_init_formation(EnemyFormation *formation, int screen_width, int screen_height, int wave)
 {
     formation->active_count = 0;
     formation->formation_offset_x = 0.0f;
@@ -21,19 +128,35 @@ void enemy_ai_init_formation(EnemyFormation *formation, int screen_width, int wa
     formation->capture_beam_timer = CAPTURE_INTERVAL;
     formation->difficulty_level = wave;
 
-    int formation_width = FORMATION_COLS * FORMATION_SPACING_X;
+    dive_path_bake_all(formation->dive_paths, screen_width / DIVE_REFERENCE_WIDTH,
+                       screen_height - DIVE_ATTACK_ROW_OFFSET - FORMATION_START_Y);
+
+    EnemyPool *enemies = &formation->enemies;
+    memset(formation->in_formation, 0, POOL_MASK_WORDS(enemies->capacity) * sizeof(uint64_t));
+
+    int cols;
+    float spacing_y;
+    formation_layout(enemies->capacity, screen_width, screen_height, &cols, &spacing_y);
+    int rows = (enemies->capacity + cols - 1) / cols;
+    if (rows < FORMATION_ROWS)
+        rows = FORMATION_ROWS;
+
+    int formation_width = cols * FORMATION_SPACING_X;
     float start_x = (screen_width - formation_width) / 2.0f;
 
     int enemy_index = 0;
 
-    for (int row = 0; row < FORMATION_ROWS && enemy_index < MAX_ENEMIES; row++)
+    for (int row = 0; row < rows && enemy_index < enemies->capacity; row++)
     {
+        /* Tall formations stretch the boss/butterfly/bee bands over all of their rows */
+        int band = row * FORMATION_ROWS / rows;
+
         EnemyType type;
-        if (row == 0)
+        if (band == 0)
         {
             type = ENEMY_BOSS;
         }
-        else if (row <= 2)
+        else if (band <= 2)
         {
             type = ENEMY_BUTTERFLY;
         }
@@ -42,18 +165,68 @@ void enemy_ai_init_formation(EnemyFormation *formation, int screen_width, int wa
             type = ENEMY_BEE;
         }
 
-        for (int col = 0; col < FORMATION_COLS && enemy_index < MAX_ENEMIES; col++)
+        for (int col = 0; col < cols && enemy_index < enemies->capacity; col++)
         {
             float form_x = start_x + col * FORMATION_SPACING_X;
-            float form_y = FORMATION_START_Y + row * FORMATION_SPACING_Y;
+            float form_y = FORMATION_START_Y + row * spacing_y;
 
-            enemy_init(&formation->enemies[enemy_index], type, enemy_index, form_x, form_y);
+            enemy_init(enemies, enemy_index, type, enemy_index, form_x, form_y);
+            pool_mask_set(formation->in_formation, enemy_index);
+            formation->sway_sin[enemy_index] = sinf(form_x * FORMATION_SWAY_FREQUENCY);
+            formation->sway_cos[enemy_index] = cosf(form_x * FORMATION_SWAY_FREQUENCY);
             enemy_index++;
             formation->active_count++;
         }
     }
 }
 
+#ifdef __SSE2__
+/* All-ones in the lanes whose bit is set in the index */
+_Alignas(16) static const uint32_t lane_masks[1 << FORMATION_LANES][FORMATION_LANES] = {
+    {0, 0, 0, 0},
+    {~0u, 0, 0, 0},
+    {0, ~0u, 0, 0},
+    {~0u, ~0u, 0, 0},
+    {0, 0, ~0u, 0},
+    {~0u, 0, ~0u, 0},
+    {0, ~0u, ~0u, 0},
+    {~0u, ~0u, ~0u, 0},
+    {0, 0, 0, ~0u},
+    {~0u, 0, 0, ~0u},
+    {0, ~0u, 0, ~0u},
+    {~0u, ~0u, 0, ~0u},
+    {0, 0, ~0u, ~0u},
+    {~0u, 0, ~0u, ~0u},
+    {0, ~0u, ~0u, ~0u},
+    {~0u, ~0u, ~0u, ~0u},
+};
+
+/* Four enemies at a time; lanes outside the mask keep their old position */
+static void formation_sway_lanes(EnemyFormation *formation, int base, unsigned lanes, float offset_x, float phase_sin,
+                                 float phase_cos, float bob)
+{
+    EnemyPool *enemies = &formation->enemies;
+    __m128 mask = _mm_load_ps((const float *)lane_masks[lanes]);
+
+    __m128 sway = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&formation->sway_sin[base]), _mm_set1_ps(phase_cos)),
+                             _mm_mul_ps(_mm_load_ps(&formation->sway_cos[base]), _mm_set1_ps(phase_sin)));
+    __m128 x = _mm_add_ps(_mm_add_ps(_mm_load_ps(&enemies->formation_x[base]), _mm_set1_ps(offset_x)),
+                          _mm_mul_ps(sway, _mm_set1_ps(FORMATION_SWAY_AMPLITUDE)));
+    __m128 y = _mm_add_ps(_mm_load_ps(&enemies->formation_y[base]), _mm_set1_ps(bob));
+
+    __m128 old_x = _mm_load_ps(&enemies->x[base]);
+    __m128 old_y = _mm_load_ps(&enemies->y[base]);
+    _mm_store_ps(&enemies->x[base], _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, old_x)));
+    _mm_store_ps(&enemies->y[base], _mm_or_ps(_mm_and_ps(mask, y), _mm_andnot_ps(mask, old_y)));
+}
+#endif
+
+/*
+ * Enemies in formation sway by sin(formation_x * frequency + phase), where
+ * the phase is shared by the whole formation. The angle-sum identity splits
+ * that into the per-enemy sway tables and one sinf/cosf pair per tick, so
+ * the per-enemy work is a few multiply-adds over the contiguous arrays.
+ */
 void enemy_ai_update_formation(EnemyFormation *formation, float dt, int screen_width)
 {
     (void)screen_width;
@@ -66,23 +239,45 @@ void enemy_ai_update_formation(EnemyFormation *formation, float dt, int screen_w
         formation->formation_direction *= -1.0f;
     }
 
-    for (int i = 0; i < MAX_ENEMIES; i++)
+    float offset_x = formation->formation_offset_x;
+    float phase = offset_x * FORMATION_SWAY_PHASE_RATE;
+    float phase_sin = sinf(phase);
+    float phase_cos = cosf(phase);
+    float bob = cosf(offset_x * FORMATION_BOB_RATE) * FORMATION_BOB_AMPLITUDE;
+
+    EnemyPool *enemies = &formation->enemies;
+    int words = POOL_MASK_WORDS(enemies->capacity);
+    for (int word = 0; word < words; word++)
     {
-        Enemy *enemy = &formation->enemies[i];
-        if (enemy->active && enemy->state == ENEMY_STATE_FORMATION)
+        uint64_t bits = enemies->active[word] & formation->in_formation[word];
+        int word_base = word * POOL_MASK_BITS;
+
+#ifdef __SSE2__
+        for (int lane = 0; bits != 0; lane += FORMATION_LANES, bits >>= FORMATION_LANES)
+        {
+            unsigned lanes = (unsigned)(bits & ((1u << FORMATION_LANES) - 1));
+            if (lanes != 0)
+                formation_sway_lanes(formation, word_base + lane, lanes, offset_x, phase_sin, phase_cos, bob);
+        }
+#else
+        while (bits != 0)
         {
-            float oscillation = sinf(enemy->formation_x * 0.5f + formation->formation_offset_x * 0.1f) * 1.5f;
-            enemy->x = enemy->formation_x + formation->formation_offset_x + oscillation;
-            enemy->y = enemy->formation_y + cosf(formation->formation_offset_x * 0.3f) * 0.5f;
+            int i = word_base + __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            float sway = formation->sway_sin[i] * phase_cos + formation->sway_cos[i] * phase_sin;
+            enemies->x[i] = enemies->formation_x[i] + offset_x + sway * FORMATION_SWAY_AMPLITUDE;
+            enemies->y[i] = enemies->formation_y[i] + bob;
         }
+#endif
     }
 }
 
-void enemy_ai_trigger_dive(EnemyFormation *formation, Player *player, int screen_height)
+void enemy_ai_trigger_dive(EnemyFormation *formation, float dt, Player *player, int screen_height, Rng *rng)
 {
     (void)screen_height;
 
-    formation->dive_spawn_timer -= 0.016f;
+    formation->dive_spawn_timer -= dt;
 
     if (formation->dive_spawn_timer > 0.0f)
     {
@@ -96,14 +291,16 @@ void enemy_ai_trigger_dive(EnemyFormation *formation, Player *player, int screen
     }
     formation->dive_spawn_timer = dive_interval;
 
-    int available_enemies[MAX_ENEMIES];
+    EnemyPool *enemies = &formation->enemies;
+    int *available_enemies = formation->dive_candidates;
     int available_count = 0;
 
-    for (int i = 0; i < MAX_ENEMIES; i++)
+    int words = POOL_MASK_WORDS(enemies->capacity);
+    for (int word = 0; word < words; word++)
     {
-        if (formation->enemies[i].active && formation->enemies[i].state == ENEMY_STATE_FORMATION)
+        for (uint64_t bits = enemies->active[word] & formation->in_formation[word]; bits != 0; bits &= bits - 1)
         {
-            available_enemies[available_count++] = i;
+            available_enemies[available_count++] = word * POOL_MASK_BITS + __builtin_ctzll(bits);
         }
     }
 
@@ -112,36 +309,31 @@ void enemy_ai_trigger_dive(EnemyFormation *formation, Player *player, int screen
         return;
     }
 
-    int dive_count = 1 + (rand() % 3);
+    int dive_count = 1 + rng_range(rng, 3);
     if (formation->difficulty_level > 3)
     {
-        dive_count = 2 + (rand() % 3);
+        dive_count = 2 + rng_range(rng, 3);
     }
 
     for (int d = 0; d < dive_count && available_count > 0; d++)
     {
-        int random_index = rand() % available_count;
+        int random_index = rng_range(rng, available_count);
         int enemy_index = available_enemies[random_index];
 
-        Enemy *enemy = &formation->enemies[enemy_index];
-        enemy->state = ENEMY_STATE_DIVING;
-        enemy->dive_timer = 0.0f;
-        enemy->dive_path_index = 0;
-
-        create_dive_path(enemy, player->x, player->y, rand() % 3);
+        start_dive(formation, enemy_index, player, (DivePattern)rng_range(rng, DIVE_PATTERN_CAPTURE));
 
         available_enemies[random_index] = available_enemies[--available_count];
     }
 }
 
-void enemy_ai_trigger_capture(EnemyFormation *formation, Player *player)
+void enemy_ai_trigger_capture(EnemyFormation *formation, float dt, Player *player)
 {
     if (player->captured || player->dual_fighter)
     {
         return;
     }
 
-    formation->capture_beam_timer -= 0.016f;
+    formation->capture_beam_timer -= dt;
 
     if (formation->capture_beam_timer > 0.0f)
     {
@@ -150,15 +342,13 @@ void enemy_ai_trigger_capture(EnemyFormation *formation, Player *player)
 
     formation->capture_beam_timer = CAPTURE_INTERVAL;
 
-    for (int i = 0; i < MAX_ENEMIES; i++)
+    EnemyPool *enemies = &formation->enemies;
+    for (int i = enemy_next(enemies, 0); i < enemies->capacity; i = enemy_next(enemies, i + 1))
     {
-        Enemy *enemy = &formation->enemies[i];
-        if (enemy->active && enemy->type == ENEMY_BOSS && enemy->state == ENEMY_STATE_FORMATION)
+        EnemyInfo *info = &enemies->info[i];
+        if (info->type == ENEMY_BOSS && info->state == ENEMY_STATE_FORMATION)
         {
-            enemy->state = ENEMY_STATE_DIVING;
-            enemy->dive_timer = 0.0f;
-            enemy->dive_path_index = 0;
-            create_dive_path(enemy, player->x, player->y, 3);
+            start_dive(formation, i, player, DIVE_PATTERN_CAPTURE);
             break;
         }
     }
@@ -167,102 +357,79 @@ void enemy_ai_trigger_capture(EnemyFormation *formation, Player *player)
 void enemy_ai_update_dives(EnemyFormation *formation, float dt, Player *player, int screen_height)
 {
     float speed_multiplier = 1.0f + (formation->difficulty_level * 0.15f);
+    float dive_speed = DIVE_SPEED * speed_multiplier;
+    float attack_y = screen_height - DIVE_ATTACK_ROW_OFFSET;
 
-    for (int i = 0; i < MAX_ENEMIES; i++)
+    EnemyPool *enemies = &formation->enemies;
+    int words = POOL_MASK_WORDS(enemies->capacity);
+    for (int word = 0; word < words; word++)
     {
-        Enemy *enemy = &formation->enemies[i];
-
-        if (!enemy->active)
-        {
-            continue;
-        }
-
-        if (enemy->state == ENEMY_STATE_DIVING)
+        /* Enemies holding formation are moved by enemy_ai_update_formation */
+        for (uint64_t bits = enemies->active[word] & ~formation->in_formation[word]; bits != 0; bits &= bits - 1)
         {
-            enemy->dive_timer += dt;
-
-            float progress = enemy->dive_timer * speed_multiplier * 0.5f;
+            int i = word * POOL_MASK_BITS + __builtin_ctzll(bits);
+            EnemyInfo *info = &enemies->info[i];
 
-            if (progress < 1.0f)
+            if (info->state == ENEMY_STATE_DIVING)
             {
-                float target_x = player->x;
-                float target_y = screen_height - 5.0f;
+                info->dive_timer += dt;
 
-                float start_x = enemy->formation_x;
-                float start_y = enemy->formation_y;
+                float offset_x, depth;
+                const DivePath *path = &formation->dive_paths[info->dive_pattern];
+                if (!dive_path_sample(path, info->dive_timer * dive_speed, &offset_x, &depth, &info->dive_path_index))
+                {
+                    /* Off the bottom of the screen; fly back up into the formation */
+                    set_state(formation, i, ENEMY_STATE_RETURNING);
+                    info->dive_timer = 0.0f;
+                    continue;
+                }
 
-                float t = progress;
-                float arc = sinf(t * 3.14159f) * 15.0f;
+                /* Home in on the player on the way down, but not while looping above the start */
+                float homing = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+                float origin_x = info->dive_origin_x;
+                float origin_y = info->dive_origin_y;
+                enemies->x[i] = origin_x + offset_x * info->dive_direction + (player->x - origin_x) * homing;
+                enemies->y[i] = origin_y + (attack_y - origin_y) * depth;
 
-                if (enemy->type == ENEMY_BOSS && !enemy->has_captured_player)
+                if (info->dive_pattern == DIVE_PATTERN_CAPTURE && !info->has_captured_player &&
+                    fabsf(enemies->x[i] - player->x) < DIVE_CAPTURE_RANGE &&
+                    fabsf(enemies->y[i] - player->y) < DIVE_CAPTURE_RANGE)
                 {
-                    enemy->x = start_x + (target_x - start_x) * t;
-                    enemy->y = start_y + (target_y - start_y) * t;
-
-                    if (fabsf(enemy->x - player->x) < 2.0f && fabsf(enemy->y - player->y) < 2.0f)
+                    if (!player->captured && !player->dual_fighter)
                     {
-                        if (!player->captured && !player->dual_fighter)
-                        {
-                            player_capture(player);
-                            enemy->has_captured_player = true;
-                        }
+                        player_capture(player);
+                        info->has_captured_player = true;
                     }
                 }
-                else
-                {
-                    float direction = (enemy->x < target_x) ? 1.0f : -1.0f;
-                    enemy->x = start_x + (target_x - start_x) * t + arc * direction;
-                    enemy->y = start_y + (target_y - start_y) * t;
-                }
             }
-            else if (progress < 1.5f)
+            else if (info->state == ENEMY_STATE_RETURNING)
             {
-                float return_progress = (progress - 1.0f) * 2.0f;
-                float target_y = screen_height + 5.0f;
-                enemy->y += (target_y - enemy->y) * dt * 2.0f;
+                float dx = enemies->formation_x[i] - enemies->x[i];
+                float dy = enemies->formation_y[i] - enemies->y[i];
+
+                /* Exponential approach, so the path home is the same at any tick rate */
+                float approach = 1.0f - expf(-RETURN_RATE * dt);
+                enemies->x[i] += dx * approach;
+                enemies->y[i] += dy * approach;
 
-                if (return_progress > 0.5f)
+                if (fabsf(dx) < 1.0f && fabsf(dy) < 1.0f)
                 {
-                    enemy->state = ENEMY_STATE_RETURNING;
-                    enemy->dive_timer = 0.0f;
+                    set_state(formation, i, ENEMY_STATE_FORMATION);
+                    enemies->x[i] = enemies->formation_x[i];
+                    enemies->y[i] = enemies->formation_y[i];
                 }
             }
         }
-        else if (enemy->state == ENEMY_STATE_RETURNING)
-        {
-            float dx = enemy->formation_x - enemy->x;
-            float dy = enemy->formation_y - enemy->y;
-
-            enemy->x += dx * dt * 2.0f;
-            enemy->y += dy * dt * 2.0f;
-
-            if (fabsf(dx) < 1.0f && fabsf(dy) < 1.0f)
-            {
-                enemy->state = ENEMY_STATE_FORMATION;
-                enemy->x = enemy->formation_x;
-                enemy->y = enemy->formation_y;
-            }
-        }
     }
 }
 
 int enemy_ai_count_active(EnemyFormation *formation)
 {
     int count = 0;
-    for (int i = 0; i < MAX_ENEMIES; i++)
+    int words = POOL_MASK_WORDS(formation->enemies.capacity);
+    for (int word = 0; word < words; word++)
     {
-        if (formation->enemies[i].active)
-        {
-            count++;
-        }
+        count += __builtin_popcountll(formation->enemies.active[word]);
     }
     return count;
 }
-
-static void create_dive_path(Enemy *enemy, float target_x, float target_y, int pattern)
-{
-    (void)target_x;
-    (void)target_y;
-    (void)pattern;
-    enemy->dive_timer = 0.0f;
-}
@@ -2,13 +2,20 @@
 #define ENEMY_AI_H
 
 #include "entities.h"
+#include "dive_path.h"
+#include "rng.h"
 
 #define FORMATION_COLS 10
 #define FORMATION_ROWS 5
 
 typedef struct
 {
-    Enemy enemies[MAX_ENEMIES];
+    EnemyPool enemies;
+    int *dive_candidates;   /* Scratch space for picking divers, one per enemy */
+    uint64_t *in_formation; /* Enemies in ENEMY_STATE_FORMATION; stale for inactive slots, so AND with active */
+    float *sway_sin;        /* Sine and cosine of each enemy's sway phase, fixed for the wave */
+    float *sway_cos;
+    DivePath *dive_paths; /* One per pattern, baked for the playfield at each wave start */
     int active_count;
     float formation_offset_x;
     float formation_direction;
@@ -17,10 +24,13 @@ typedef struct
     int difficulty_level;
 } EnemyFormation;
 
-void enemy_ai_init_formation(EnemyFormation *formation, int screen_width, int wave);
+size_t enemy_ai_formation_size(int capacity);
+bool enemy_ai_formation_create(EnemyFormation *formation, int capacity, Arena *arena);
+void enemy_ai_reset_formation(EnemyFormation *formation);
+void enemy_ai_init_formation(EnemyFormation *formation, int screen_width, int screen_height, int wave);
 void enemy_ai_update_formation(EnemyFormation *formation, float dt, int screen_width);
-void enemy_ai_trigger_dive(EnemyFormation *formation, Player *player, int screen_height);
-void enemy_ai_trigger_capture(EnemyFormation *formation, Player *player);
+void enemy_ai_trigger_dive(EnemyFormation *formation, float dt, Player *player, int screen_height, Rng *rng);
+void enemy_ai_trigger_capture(EnemyFormation *formation, float dt, Player *player);
 void enemy_ai_update_dives(EnemyFormation *formation, float dt, Player *player, int screen_height);
 int enemy_ai_count_active(EnemyFormation *formation);
 
@@ -1,6 +1,6 @@
 #include "entities.h"
-#include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 /* Movement speeds */
 #define PLAYER_SPEED_X 35.0f
@@ -53,6 +53,8 @@ void player_init(Player *player, int screen_width, int screen_height)
 
     player->x = (min_x + max_x) / 2.0f; /* Center horizontally */
     player->y = max_y - 1.0f;           /* Near bottom, safely within bounds */
+    player->prev_x = player->x;
+    player->prev_y = player->y;
     player->vx = 0.0f;
     player->vy = 0.0f;
     player->lives = PLAYER_STARTING_LIVES;
@@ -226,7 +228,7 @@ void player_update(Player *player, float dt, int screen_width, int screen_height
     }
 }
 
-void player_shoot(Player *player, Bullet bullets[], int max_bullets)
+void player_shoot(Player *player, BulletPool *bullets)
 {
     if (player->shoot_cooldown > 0.0f)
         return;
@@ -240,41 +242,22 @@ void player_shoot(Player *player, Bullet bullets[], int max_bullets)
     else if (player->has_lightning)
         bullet_type = BULLET_LIGHTNING;
 
-    for (int i = 0; i < max_bullets; i++)
-    {
-        if (!bullets[i].active)
-        {
-            /* Fire primary bullet */
-            bullet_init_special(&bullets[i], player->x, player->y - 1.0f, 0.0f, -BULLET_SPEED, true, bullet_type);
-            player->shoot_cooldown = PLAYER_SHOOT_COOLDOWN;
-
-            /* Fire dual-shot bullet if power-up is active */
-            if (player->has_dual_shot && i + 1 < max_bullets)
-            {
-                bullet_init_special(&bullets[i + 1], player->x - 1.0f, player->y - 1.0f, 0.0f, -BULLET_SPEED, true,
-                                    bullet_type);
-                i++;
-            }
-
-            /* Fire dual-fighter bullet if active */
-            if (player->dual_fighter && i + 1 < max_bullets)
-            {
-                bullet_init_special(&bullets[i + 1], player->x + 2.0f, player->y - 1.0f, 0.0f, -BULLET_SPEED, true,
-                                    bullet_type);
-                i++;
-            }
-
-            /* Ally drone shoots if active */
-            if (player->has_ally_drone && i + 1 < max_bullets)
-            {
-                bullet_init(&bullets[i + 1], player->ally_drone_x, player->ally_drone_y - 1.0f, 0.0f, -BULLET_SPEED,
-                            true);
-                i++;
-            }
-
-            break;
-        }
-    }
+    /* Fire primary bullet */
+    if (bullet_spawn_special(bullets, player->x, player->y - 1.0f, 0.0f, -BULLET_SPEED, true, bullet_type) < 0)
+        return;
+    player->shoot_cooldown = PLAYER_SHOOT_COOLDOWN;
+
+    /* Fire dual-shot bullet if power-up is active */
+    if (player->has_dual_shot)
+        bullet_spawn_special(bullets, player->x - 1.0f, player->y - 1.0f, 0.0f, -BULLET_SPEED, true, bullet_type);
+
+    /* Fire dual-fighter bullet if active */
+    if (player->dual_fighter)
+        bullet_spawn_special(bullets, player->x + 2.0f, player->y - 1.0f, 0.0f, -BULLET_SPEED, true, bullet_type);
+
+    /* Ally drone shoots if active */
+    if (player->has_ally_drone)
+        bullet_spawn(bullets, player->ally_drone_x, player->ally_drone_y - 1.0f, 0.0f, -BULLET_SPEED, true);
 }
 
 void player_hit(Player *player)
@@ -312,104 +295,259 @@ void player_free(Player *player)
     player->dual_fighter = true;
 }
 
-void bullet_init(Bullet *bullet, float x, float y, float vx, float vy, bool is_player)
+void entity_capacities_default(EntityCapacities *capacities)
+{
+    capacities->enemies = DEFAULT_MAX_ENEMIES;
+    capacities->bullets = DEFAULT_MAX_BULLETS;
+    capacities->powerups = DEFAULT_MAX_POWERUPS;
+    capacities->stars = DEFAULT_MAX_STARS;
+}
+
+static bool capacity_valid(int capacity)
+{
+    return capacity >= 1 && capacity <= MAX_ENTITY_CAPACITY;
+}
+
+bool entity_capacities_valid(const EntityCapacities *capacities)
+{
+    return capacity_valid(capacities->enemies) && capacity_valid(capacities->bullets) &&
+           capacity_valid(capacities->powerups) && capacity_valid(capacities->stars);
+}
+
+/* Hand out the next aligned array from a pool's block */
+static void *pool_carve(char **cursor, size_t size)
+{
+    void *array = *cursor;
+    *cursor += arena_align(size);
+    return array;
+}
+
+/* Arena space taken by a bullet pool of the given capacity */
+size_t bullet_pool_size(int capacity)
+{
+    return 6 * arena_align(capacity * sizeof(float)) + arena_align(POOL_MASK_WORDS(capacity) * sizeof(uint64_t)) +
+           arena_align(capacity * sizeof(BulletInfo)) + 2 * arena_align(capacity * sizeof(int));
+}
+
+bool bullet_pool_init(BulletPool *pool, int capacity, Arena *arena)
 {
-    bullet->x = x;
-    bullet->y = y;
-    bullet->vx = vx;
-    bullet->vy = vy;
-    bullet->active = true;
-    bullet->is_player_bullet = is_player;
-    bullet->type = BULLET_NORMAL;
-    bullet->pierce_count = 0;
-    bullet->target_enemy_id = -1;
-    bullet->chain_count = 0;
+    char *cursor = arena_alloc(arena, bullet_pool_size(capacity), 1);
+    if (!cursor)
+        return false;
+
+    pool->capacity = capacity;
+    pool->x = pool_carve(&cursor, capacity * sizeof(float));
+    pool->y = pool_carve(&cursor, capacity * sizeof(float));
+    pool->prev_x = pool_carve(&cursor, capacity * sizeof(float));
+    pool->prev_y = pool_carve(&cursor, capacity * sizeof(float));
+    pool->vx = pool_carve(&cursor, capacity * sizeof(float));
+    pool->vy = pool_carve(&cursor, capacity * sizeof(float));
+    pool->active = pool_carve(&cursor, POOL_MASK_WORDS(capacity) * sizeof(uint64_t));
+    pool->info = pool_carve(&cursor, capacity * sizeof(BulletInfo));
+    pool->dense = pool_carve(&cursor, capacity * sizeof(int));
+    pool->link = pool_carve(&cursor, capacity * sizeof(int));
+
+    bullet_pool_clear(pool);
+    return true;
 }
 
-void bullet_init_special(Bullet *bullet, float x, float y, float vx, float vy, bool is_player, BulletType type)
+/* Release every bullet; the free list hands out low slots first again */
+void bullet_pool_clear(BulletPool *pool)
 {
-    bullet_init(bullet, x, y, vx, vy, is_player);
-    bullet->type = type;
+    memset(pool->active, 0, POOL_MASK_WORDS(pool->capacity) * sizeof(uint64_t));
+
+    for (int i = 0; i < pool->capacity; i++)
+        pool->link[i] = i + 1 < pool->capacity ? i + 1 : -1;
+    pool->free_head = pool->capacity > 0 ? 0 : -1;
+    pool->count = 0;
+}
+
+/* Enemy bullets advance by enemy_dt, which is shorter while the player has time slow */
+void bullet_pool_update(BulletPool *pool, float dt, float enemy_dt, int screen_height)
+{
+    for (int d = pool->count - 1; d >= 0; d--)
+    {
+        int i = pool->dense[d];
+        float step = pool->info[i].is_player_bullet ? dt : enemy_dt;
+        pool->x[i] += pool->vx[i] * step;
+        pool->y[i] += pool->vy[i] * step;
+
+        /* Release if off-screen */
+        if (pool->y[i] < 0.0f || pool->y[i] >= (float)screen_height)
+            bullet_release(pool, i);
+    }
+}
+
+static void bullet_init(BulletPool *pool, int index, float x, float y, float vx, float vy, bool is_player)
+{
+    pool->x[index] = x;
+    pool->y[index] = y;
+    pool->prev_x[index] = x;
+    pool->prev_y[index] = y;
+    pool->vx[index] = vx;
+    pool->vy[index] = vy;
+
+    BulletInfo *info = &pool->info[index];
+    info->is_player_bullet = is_player;
+    info->type = BULLET_NORMAL;
+    info->pierce_count = 0;
+    info->target_enemy_id = -1;
+    info->chain_count = 0;
+}
+
+/* Take a slot off the free list and initialize it; returns the slot, or -1 if the pool is full */
+int bullet_spawn(BulletPool *pool, float x, float y, float vx, float vy, bool is_player)
+{
+    int index = pool->free_head;
+    if (index < 0)
+        return -1;
+
+    pool->free_head = pool->link[index];
+    pool->link[index] = pool->count;
+    pool->dense[pool->count++] = index;
+    pool_mask_set(pool->active, index);
+
+    bullet_init(pool, index, x, y, vx, vy, is_player);
+    return index;
+}
+
+int bullet_spawn_special(BulletPool *pool, float x, float y, float vx, float vy, bool is_player, BulletType type)
+{
+    int index = bullet_spawn(pool, x, y, vx, vy, is_player);
+    if (index < 0)
+        return -1;
+
+    BulletInfo *info = &pool->info[index];
+    info->type = type;
 
     /* Set special properties based on type */
     if (type == BULLET_MEGA_LASER)
-        bullet->pierce_count = 3; /* Can pierce through 3 enemies */
+        info->pierce_count = 3; /* Can pierce through 3 enemies */
     else if (type == BULLET_LIGHTNING)
-        bullet->chain_count = 4; /* Can chain to 4 enemies */
+        info->chain_count = 4; /* Can chain to 4 enemies */
+
+    return index;
 }
 
-void bullet_update(Bullet *bullet, float dt, int screen_height)
+/* Return a live slot to the free list, filling its dense position with the last live bullet */
+void bullet_release(BulletPool *pool, int index)
 {
-    if (!bullet->active)
-        return;
+    int position = pool->link[index];
+    int last = pool->dense[--pool->count];
+    pool->dense[position] = last;
+    pool->link[last] = position;
+
+    pool->link[index] = pool->free_head;
+    pool->free_head = index;
+    pool_mask_clear(pool->active, index);
+}
 
-    bullet->x += bullet->vx * dt;
-    bullet->y += bullet->vy * dt;
+size_t enemy_pool_size(int capacity)
+{
+    return 8 * arena_align(capacity * sizeof(float)) + arena_align(POOL_MASK_WORDS(capacity) * sizeof(uint64_t)) +
+           arena_align(capacity * sizeof(EnemyInfo));
+}
 
-    /* Deactivate if off-screen */
-    if (bullet->y < 0.0f || bullet->y >= (float)screen_height)
-        bullet->active = false;
+bool enemy_pool_init(EnemyPool *pool, int capacity, Arena *arena)
+{
+    /* Pools are carved once from a fresh arena, which is zeroed, so unused slots hold no garbage floats */
+    char *cursor = arena_alloc(arena, enemy_pool_size(capacity), 1);
+    if (!cursor)
+        return false;
+
+    pool->capacity = capacity;
+    pool->x = pool_carve(&cursor, capacity * sizeof(float));
+    pool->y = pool_carve(&cursor, capacity * sizeof(float));
+    pool->prev_x = pool_carve(&cursor, capacity * sizeof(float));
+    pool->prev_y = pool_carve(&cursor, capacity * sizeof(float));
+    pool->vx = pool_carve(&cursor, capacity * sizeof(float));
+    pool->vy = pool_carve(&cursor, capacity * sizeof(float));
+    pool->formation_x = pool_carve(&cursor, capacity * sizeof(float));
+    pool->formation_y = pool_carve(&cursor, capacity * sizeof(float));
+    pool->active = pool_carve(&cursor, POOL_MASK_WORDS(capacity) * sizeof(uint64_t));
+    pool->info = pool_carve(&cursor, capacity * sizeof(EnemyInfo));
+    return true;
 }
 
-void enemy_init(Enemy *enemy, EnemyType type, int formation_index, float form_x, float form_y)
+/* Velocities go too, like enemy_deactivate, so cleared slots stay put in enemy_pool_update */
+void enemy_pool_clear(EnemyPool *pool)
 {
-    enemy->x = form_x;
-    enemy->y = form_y;
-    enemy->vx = 0.0f;
-    enemy->vy = 0.0f;
-    enemy->type = type;
-    enemy->state = ENEMY_STATE_FORMATION;
-    enemy->active = true;
-    enemy->formation_index = formation_index;
-    enemy->formation_x = form_x;
-    enemy->formation_y = form_y;
-    enemy->dive_timer = 0.0f;
-    enemy->shoot_cooldown = 0.0f;
-    enemy->dive_path_index = 0;
-    enemy->has_captured_player = false;
-    enemy->animation_frame = 0;
-    enemy->animation_timer = 0.0f;
+    memset(pool->active, 0, POOL_MASK_WORDS(pool->capacity) * sizeof(uint64_t));
+    memset(pool->vx, 0, pool->capacity * sizeof(float));
+    memset(pool->vy, 0, pool->capacity * sizeof(float));
 }
 
-void enemy_update(Enemy *enemy, float dt)
+void enemy_init(EnemyPool *pool, int index, EnemyType type, int formation_index, float form_x, float form_y)
 {
-    if (!enemy->active)
-        return;
+    pool->x[index] = form_x;
+    pool->y[index] = form_y;
+    pool->prev_x[index] = form_x;
+    pool->prev_y[index] = form_y;
+    pool->vx[index] = 0.0f;
+    pool->vy[index] = 0.0f;
+    pool->formation_x[index] = form_x;
+    pool->formation_y[index] = form_y;
+    pool_mask_set(pool->active, index);
+
+    EnemyInfo *info = &pool->info[index];
+    info->type = type;
+    info->state = ENEMY_STATE_FORMATION;
+    info->formation_index = formation_index;
+    info->dive_timer = 0.0f;
+    info->shoot_cooldown = 0.0f;
+    info->dive_path_index = 0;
+    info->dive_pattern = 0;
+    info->dive_direction = 1.0f;
+    info->dive_origin_x = form_x;
+    info->dive_origin_y = form_y;
+    info->has_captured_player = false;
+    info->animation_frame = 0;
+    info->animation_timer = 0.0f;
+}
 
-    /* Update animation */
-    enemy->animation_timer += dt;
-    if (enemy->animation_timer >= ENEMY_ANIMATION_FRAME_TIME)
+void enemy_pool_update(EnemyPool *pool, float dt)
+{
+    /*
+     * Integrate every slot of the formation pool so the loop has no
+     * branches; dead slots do not move because enemy_deactivate and
+     * enemy_pool_clear zero their velocity.
+     */
+    for (int i = 0; i < pool->capacity; i++)
     {
-        enemy->animation_frame = (enemy->animation_frame + 1) % ENEMY_ANIMATION_FRAMES;
-        enemy->animation_timer = 0.0f;
+        pool->x[i] += pool->vx[i] * dt;
+        pool->y[i] += pool->vy[i] * dt;
     }
 
-    /* Update position */
-    enemy->x += enemy->vx * dt;
-    enemy->y += enemy->vy * dt;
+    for (int i = enemy_next(pool, 0); i < pool->capacity; i = enemy_next(pool, i + 1))
+    {
+        EnemyInfo *info = &pool->info[i];
 
-    /* Update shoot cooldown */
-    if (enemy->shoot_cooldown > 0.0f)
-        enemy->shoot_cooldown -= dt;
+        /* Update animation */
+        info->animation_timer += dt;
+        if (info->animation_timer >= ENEMY_ANIMATION_FRAME_TIME)
+        {
+            info->animation_frame = (info->animation_frame + 1) % ENEMY_ANIMATION_FRAMES;
+            info->animation_timer = 0.0f;
+        }
+
+        /* Update shoot cooldown */
+        if (info->shoot_cooldown > 0.0f)
+            info->shoot_cooldown -= dt;
+    }
 }
 
-void enemy_shoot(Enemy *enemy, Bullet bullets[], int max_bullets)
+void enemy_shoot(EnemyPool *pool, int index, BulletPool *bullets, Rng *rng)
 {
-    if (enemy->shoot_cooldown > 0.0f || !enemy->active)
+    EnemyInfo *info = &pool->info[index];
+    if (info->shoot_cooldown > 0.0f || !enemy_is_active(pool, index))
         return;
 
-    for (int i = 0; i < max_bullets; i++)
-    {
-        if (!bullets[i].active)
-        {
-            bullet_init(&bullets[i], enemy->x, enemy->y + 1.0f, 0.0f, ENEMY_BULLET_SPEED, false);
+    if (bullet_spawn(bullets, pool->x[index], pool->y[index] + 1.0f, 0.0f, ENEMY_BULLET_SPEED, false) < 0)
+        return;
 
-            /* Randomize cooldown for variety */
-            float random_offset = (rand() % 100) / (100.0f / ENEMY_SHOOT_COOLDOWN_RANDOM_RANGE);
-            enemy->shoot_cooldown = ENEMY_SHOOT_COOLDOWN_MIN + random_offset;
-            break;
-        }
-    }
+    /* Randomize cooldown for variety */
+    float random_offset = rng_range(rng, 100) / (100.0f / ENEMY_SHOOT_COOLDOWN_RANDOM_RANGE);
+    info->shoot_cooldown = ENEMY_SHOOT_COOLDOWN_MIN + random_offset;
 }
 
 void powerup_init(PowerUp *powerup, float x, float y, PowerUpType type)
@@ -486,15 +624,15 @@ void powerup_apply(PowerUp *powerup, Player *player)
     powerup->active = false;
 }
 
-void stars_init(Star stars[], int count, int screen_width, int screen_height)
+void stars_init(Star stars[], int count, int screen_width, int screen_height, Rng *rng)
 {
 #define STAR_BOTTOM_MARGIN 5
 #define STAR_TYPE_DIVISOR 3
 
     for (int i = 0; i < count; i++)
     {
-        stars[i].x = rand() % screen_width;
-        stars[i].y = rand() % (screen_height - STAR_BOTTOM_MARGIN);
-        stars[i].character = (rand() % STAR_TYPE_DIVISOR == 0) ? '*' : '.';
+        stars[i].x = rng_range(rng, screen_width);
+        stars[i].y = rng_range(rng, screen_height - STAR_BOTTOM_MARGIN);
+        stars[i].character = (rng_range(rng, STAR_TYPE_DIVISOR) == 0) ? '*' : '.';
     }
 }
@@ -3,12 +3,16 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
+#include "rng.h"
+#include "arena.h"
 
-/* Entity limits */
-#define MAX_ENEMIES 50
-#define MAX_BULLETS 100
-#define MAX_POWERUPS 5
-#define MAX_STARS 50
+/* Default entity limits; the actual capacities are chosen at startup */
+#define DEFAULT_MAX_ENEMIES 50
+#define DEFAULT_MAX_BULLETS 100
+#define DEFAULT_MAX_POWERUPS 5
+#define DEFAULT_MAX_STARS 50
+#define MAX_ENTITY_CAPACITY 1000000
 
 /* Player constants */
 #define PLAYER_STARTING_LIVES 3
@@ -48,6 +52,7 @@ typedef enum
 typedef struct
 {
     float x, y;
+    float prev_x, prev_y; /* Position at the start of the tick, for render interpolation */
     float vx, vy;
     int lives;
     int health;
@@ -99,35 +104,129 @@ typedef enum
     BULLET_LIGHTNING
 } BulletType;
 
+/*
+ * Bullets and enemies live in structure-of-arrays pools: the per-tick update
+ * and collision loops stream through the position and velocity arrays, while
+ * fields they rarely touch sit in a per-slot info table. Liveness is one bit
+ * per slot.
+ */
+#define POOL_MASK_BITS 64
+#define POOL_MASK_WORDS(capacity) (((capacity) + POOL_MASK_BITS - 1) / POOL_MASK_BITS)
+
 typedef struct
 {
-    float x, y;
-    float vx, vy;
-    bool active;
     bool is_player_bullet;
     BulletType type;
     int pierce_count;      /* For mega laser */
     float target_enemy_id; /* For homing missiles */
     int chain_count;       /* For lightning */
-} Bullet;
+} BulletInfo;
+
+/*
+ * Bullets come and go every tick, so their pool also keeps an intrusive free
+ * list and a dense list of live slots: spawning and releasing are O(1), and
+ * loops visit live bullets only. A loop that releases bullets must walk the
+ * dense list backwards, since releasing moves the last entry into the hole.
+ */
+typedef struct
+{
+    int capacity;
+    float *x, *y;
+    float *prev_x, *prev_y; /* Position at the start of the tick, for render interpolation */
+    float *vx, *vy;
+    uint64_t *active;
+    BulletInfo *info;
+    int *dense;    /* Live slots, packed at the front */
+    int *link;     /* Position in dense of a live slot, next free slot of a free one */
+    int count;     /* Number of live bullets */
+    int free_head; /* First free slot, -1 when the pool is full */
+} BulletPool;
 
 typedef struct
 {
-    float x, y;
-    float vx, vy;
     EnemyType type;
     EnemyState state;
-    bool active;
     int formation_index;
-    float formation_x;
-    float formation_y;
     float dive_timer;
     float shoot_cooldown;
-    int dive_path_index;
+    int dive_path_index;  /* Current sample in the dive path table */
+    int dive_pattern;     /* DivePattern being flown */
+    float dive_direction; /* 1 or -1, mirrors the path toward the player */
+    float dive_origin_x;  /* Where the dive began */
+    float dive_origin_y;
     bool has_captured_player;
     int animation_frame;
     float animation_timer;
-} Enemy;
+} EnemyInfo;
+
+typedef struct
+{
+    int capacity;
+    float *x, *y;
+    float *prev_x, *prev_y;
+    float *vx, *vy;
+    float *formation_x, *formation_y;
+    uint64_t *active;
+    EnemyInfo *info;
+} EnemyPool;
+
+static inline bool pool_mask_test(const uint64_t *mask, int index)
+{
+    return (mask[index / POOL_MASK_BITS] >> (index % POOL_MASK_BITS)) & 1;
+}
+
+static inline void pool_mask_set(uint64_t *mask, int index)
+{
+    mask[index / POOL_MASK_BITS] |= (uint64_t)1 << (index % POOL_MASK_BITS);
+}
+
+static inline void pool_mask_clear(uint64_t *mask, int index)
+{
+    mask[index / POOL_MASK_BITS] &= ~((uint64_t)1 << (index % POOL_MASK_BITS));
+}
+
+/* First set bit at or after index, or capacity if there is none */
+static inline int pool_mask_next(const uint64_t *mask, int capacity, int index)
+{
+    int word = index / POOL_MASK_BITS;
+    int words = POOL_MASK_WORDS(capacity);
+    if (word >= words)
+        return capacity;
+
+    uint64_t bits = mask[word] & (~(uint64_t)0 << (index % POOL_MASK_BITS));
+    while (bits == 0)
+    {
+        if (++word >= words)
+            return capacity;
+        bits = mask[word];
+    }
+
+    int next = word * POOL_MASK_BITS + __builtin_ctzll(bits);
+    return next < capacity ? next : capacity;
+}
+
+static inline bool bullet_is_active(const BulletPool *pool, int index)
+{
+    return pool_mask_test(pool->active, index);
+}
+
+static inline bool enemy_is_active(const EnemyPool *pool, int index)
+{
+    return pool_mask_test(pool->active, index);
+}
+
+/* Stop the slot too, since enemy_pool_update moves every slot of the formation pool, live or not */
+static inline void enemy_deactivate(EnemyPool *pool, int index)
+{
+    pool_mask_clear(pool->active, index);
+    pool->vx[index] = 0.0f;
+    pool->vy[index] = 0.0f;
+}
+
+static inline int enemy_next(const EnemyPool *pool, int index)
+{
+    return pool_mask_next(pool->active, pool->capacity, index);
+}
 
 typedef struct
 {
@@ -144,25 +243,44 @@ typedef struct
     char character;
 } Star;
 
+/* How many of each entity the game allocates room for */
+typedef struct
+{
+    int enemies;
+    int bullets;
+    int powerups;
+    int stars;
+} EntityCapacities;
+
 void player_init(Player *player, int screen_width, int screen_height);
 void player_update(Player *player, float dt, int screen_width, int screen_height);
-void player_shoot(Player *player, Bullet bullets[], int max_bullets);
+void player_shoot(Player *player, BulletPool *bullets);
 void player_hit(Player *player);
 void player_capture(Player *player);
 void player_free(Player *player);
 
-void bullet_init(Bullet *bullet, float x, float y, float vx, float vy, bool is_player);
-void bullet_init_special(Bullet *bullet, float x, float y, float vx, float vy, bool is_player, BulletType type);
-void bullet_update(Bullet *bullet, float dt, int screen_height);
+void entity_capacities_default(EntityCapacities *capacities);
+bool entity_capacities_valid(const EntityCapacities *capacities);
+
+size_t bullet_pool_size(int capacity);
+bool bullet_pool_init(BulletPool *pool, int capacity, Arena *arena);
+void bullet_pool_clear(BulletPool *pool);
+void bullet_pool_update(BulletPool *pool, float dt, float enemy_dt, int screen_height);
+int bullet_spawn(BulletPool *pool, float x, float y, float vx, float vy, bool is_player);
+int bullet_spawn_special(BulletPool *pool, float x, float y, float vx, float vy, bool is_player, BulletType type);
+void bullet_release(BulletPool *pool, int index);
 
-void enemy_init(Enemy *enemy, EnemyType type, int formation_index, float form_x, float form_y);
-void enemy_update(Enemy *enemy, float dt);
-void enemy_shoot(Enemy *enemy, Bullet bullets[], int max_bullets);
+size_t enemy_pool_size(int capacity);
+bool enemy_pool_init(EnemyPool *pool, int capacity, Arena *arena);
+void enemy_pool_clear(EnemyPool *pool);
+void enemy_pool_update(EnemyPool *pool, float dt);
+void enemy_init(EnemyPool *pool, int index, EnemyType type, int formation_index, float form_x, float form_y);
+void enemy_shoot(EnemyPool *pool, int index, BulletPool *bullets, Rng *rng);
 
 void powerup_init(PowerUp *powerup, float x, float y, PowerUpType type);
 void powerup_update(PowerUp *powerup, float dt, int screen_height);
 void powerup_apply(PowerUp *powerup, Player *player);
 
-void stars_init(Star stars[], int count, int screen_width, int screen_height);
+void stars_init(Star stars[], int count, int screen_width, int screen_height, Rng *rng);
 
 #endif
@@ -0,0 +1,528 @@
+#include "game.h"
+#include "collision.h"
+#include "renderer.h"
+#include "trace.h"
+#include <string.h>
+
+/* Gameplay constants */
+#define POWERUP_DROP_CHANCE 15
+#define ENEMY_SHOOT_RATE 0.15f /* Shots per second from each enemy in formation */
+#define ENEMY_SHOOT_ROLL_RANGE 1000000
+#define BULLET_SPEED 30.0f
+#define TIME_SLOW_FACTOR 0.5f /* Enemy speed while the time slow power-up is active */
+
+static void spawn_powerup(PowerUp powerups[], int max_powerups, float x, float y, Rng *rng)
+{
+    /* Random chance to drop a power-up */
+    if (rng_range(rng, 100) < POWERUP_DROP_CHANCE)
+    {
+        for (int i = 0; i < max_powerups; i++)
+        {
+            if (!powerups[i].active)
+            {
+                /* Weighted random selection of powerup types */
+                int roll = rng_range(rng, 100);
+                PowerUpType type;
+
+                if (roll < 15)
+                    type = POWERUP_DUAL_SHOT;
+                else if (roll < 30)
+                    type = POWERUP_SHIELD;
+                else if (roll < 40)
+                    type = POWERUP_SPEED;
+                else if (roll < 50)
+                    type = POWERUP_MEGA_LASER;
+                else if (roll < 60)
+                    type = POWERUP_BOMB;
+                else if (roll < 70)
+                    type = POWERUP_HOMING;
+                else if (roll < 78)
+                    type = POWERUP_LIGHTNING;
+                else if (roll < 86)
+                    type = POWERUP_REFLECT_SHIELD;
+                else if (roll < 94)
+                    type = POWERUP_TIME_SLOW;
+                else
+                    type = POWERUP_ALLY_DRONE; /* Rarest powerup */
+
+                powerup_init(&powerups[i], x, y, type);
+                break;
+            }
+        }
+    }
+}
+
+/* Arena space for everything game_init allocates */
+static size_t game_arena_size(int screen_width, int screen_height, const EntityCapacities *capacities)
+{
+    return bullet_pool_size(capacities->bullets) + enemy_ai_formation_size(capacities->enemies) + bonus_stage_size() +
+           collision_grid_size(screen_width, screen_height, capacities->enemies) +
+           arena_align(capacities->enemies * sizeof(int)) + arena_align(capacities->powerups * sizeof(PowerUp)) +
+           arena_align(capacities->stars * sizeof(Star));
+}
+
+bool game_init(Game *game, int screen_width, int screen_height, const EntityCapacities *capacities, uint64_t seed)
+{
+    game->screen_width = screen_width;
+    game->screen_height = screen_height;
+    game->capacities = *capacities;
+    game->profiler = NULL;
+
+    if (!arena_init(&game->arena, game_arena_size(screen_width, screen_height, capacities)))
+        return false;
+
+    Arena *arena = &game->arena;
+    game->powerups = arena_alloc(arena, capacities->powerups, sizeof(PowerUp));
+    game->stars = arena_alloc(arena, capacities->stars, sizeof(Star));
+    game->hit_candidates = arena_alloc(arena, capacities->enemies, sizeof(int));
+
+    if (!game->powerups || !game->stars || !game->hit_candidates ||
+        !bullet_pool_init(&game->bullets, capacities->bullets, arena) ||
+        !enemy_ai_formation_create(&game->formation, capacities->enemies, arena) ||
+        !bonus_stage_create(&game->bonus_stage, arena) ||
+        !collision_grid_init(&game->grid, screen_width, screen_height, capacities->enemies, arena))
+    {
+        arena_free(arena);
+        return false;
+    }
+
+    game_reset(game, seed);
+    return true;
+}
+
+/* Start over from the menu without reallocating */
+void game_reset(Game *game, uint64_t seed)
+{
+    int screen_width = game->screen_width;
+    int screen_height = game->screen_height;
+
+    game->started = false;
+
+    player_init(&game->player, screen_width, screen_height);
+
+    bullet_pool_clear(&game->bullets);
+    for (int i = 0; i < game->capacities.powerups; i++)
+        game->powerups[i].active = false;
+    rng_seed(&game->rng, seed);
+    stars_init(game->stars, game->capacities.stars, screen_width, screen_height, &game->rng);
+
+    game_state_init(&game->game_state);
+
+    enemy_ai_reset_formation(&game->formation);
+    bonus_stage_reset(&game->bonus_stage);
+}
+
+void game_free(Game *game)
+{
+    arena_free(&game->arena);
+}
+
+/* Remember where moving entities were at the start of the tick for render interpolation */
+static void game_save_positions(Game *game)
+{
+    game->player.prev_x = game->player.x;
+    game->player.prev_y = game->player.y;
+
+    BulletPool *bullets = &game->bullets;
+    for (int d = 0; d < bullets->count; d++)
+    {
+        int i = bullets->dense[d];
+        bullets->prev_x[i] = bullets->x[i];
+        bullets->prev_y[i] = bullets->y[i];
+    }
+
+    EnemyPool *enemies = &game->formation.enemies;
+    memcpy(enemies->prev_x, enemies->x, enemies->capacity * sizeof(float));
+    memcpy(enemies->prev_y, enemies->y, enemies->capacity * sizeof(float));
+
+    EnemyPool *bonus_enemies = &game->bonus_stage.enemies;
+    memcpy(bonus_enemies->prev_x, bonus_enemies->x, bonus_enemies->capacity * sizeof(float));
+    memcpy(bonus_enemies->prev_y, bonus_enemies->y, bonus_enemies->capacity * sizeof(float));
+}
+
+void game_update(Game *game, InputState *input, float dt)
+{
+    BulletPool *bullets = &game->bullets;
+    EnemyPool *enemies = &game->formation.enemies;
+
+    game_save_positions(game);
+
+    /* Time slow holds back enemies and their fire, not the player */
+    float enemy_dt = game->player.has_time_slow ? dt * TIME_SLOW_FACTOR : dt;
+
+    if (input->god_toggle)
+    {
+        game->player.god_mode = !game->player.god_mode;
+    }
+
+    if (game->game_state.state == GAME_STATE_MENU)
+    {
+        if (input->shoot && !game->started)
+        {
+            game->started = true;
+            game_state_start_wave(&game->game_state, &game->formation, game->screen_width, game->screen_height);
+        }
+    }
+    else if (game->game_state.state == GAME_STATE_PLAYING)
+    {
+        profiler_begin(game->profiler, PROFILE_PLAYER);
+
+        game->player.vx = 0.0f;
+        game->player.vy = 0.0f;
+
+        if (input->left)
+            game->player.vx = -1.0f;
+        if (input->right)
+            game->player.vx = 1.0f;
+        if (input->up)
+            game->player.vy = -1.0f;
+        if (input->down)
+            game->player.vy = 1.0f;
+        if (input->shoot)
+            player_shoot(&game->player, bullets);
+
+        /* Handle bomb */
+        if (input->bomb && game->player.bomb_count > 0)
+        {
+            game->player.bomb_count--;
+            /* Clear all enemies on screen */
+            int cleared = 0;
+            for (int i = enemy_next(enemies, 0); i < enemies->capacity; i = enemy_next(enemies, i + 1))
+            {
+                cleared++;
+                int score = 50; /* Reduced score for bomb kills */
+                if (enemies->info[i].type == ENEMY_BUTTERFLY)
+                    score = 75;
+                if (enemies->info[i].type == ENEMY_BOSS)
+                    score = 150;
+                enemy_deactivate(enemies, i);
+                game_state_add_score(&game->game_state, score);
+            }
+            trace_instant("bomb", "enemies", cleared);
+            /* Clear all enemy bullets */
+            for (int d = bullets->count - 1; d >= 0; d--)
+            {
+                int i = bullets->dense[d];
+                if (!bullets->info[i].is_player_bullet)
+                    bullet_release(bullets, i);
+            }
+        }
+
+        /* Handle special weapon */
+        if (input->special && game->player.special_ready)
+        {
+            game->player.special_ready = false;
+            game->player.special_charge = 0.0f;
+            /* Fire a spread of mega lasers */
+            for (int spread_count = 0; spread_count < 5; spread_count++)
+            {
+                float angle = -0.4f + (spread_count * 0.2f);
+                int i = bullet_spawn_special(bullets, game->player.x, game->player.y - 1.0f, angle * BULLET_SPEED,
+                                             -BULLET_SPEED, true, BULLET_MEGA_LASER);
+                if (i < 0)
+                    break;
+                bullets->info[i].pierce_count = 10; /* Super pierce */
+            }
+        }
+
+        player_update(&game->player, dt, game->screen_width, game->screen_height);
+
+        profiler_end(game->profiler, PROFILE_PLAYER);
+        profiler_begin(game->profiler, PROFILE_ENEMY_AI);
+
+        enemy_ai_update_formation(&game->formation, enemy_dt, game->screen_width);
+        enemy_ai_trigger_dive(&game->formation, enemy_dt, &game->player, game->screen_height, &game->rng);
+        enemy_ai_trigger_capture(&game->formation, enemy_dt, &game->player);
+        enemy_ai_update_dives(&game->formation, enemy_dt, &game->player, game->screen_height);
+
+        enemy_pool_update(enemies, enemy_dt);
+
+        /* Chance per tick out of ENEMY_SHOOT_ROLL_RANGE, so the firing rate holds at any tick rate */
+        float shoot_threshold = ENEMY_SHOOT_RATE * enemy_dt * ENEMY_SHOOT_ROLL_RANGE;
+        for (int i = enemy_next(enemies, 0); i < enemies->capacity; i = enemy_next(enemies, i + 1))
+        {
+            if (enemies->info[i].state == ENEMY_STATE_FORMATION &&
+                rng_range(&game->rng, ENEMY_SHOOT_ROLL_RANGE) < shoot_threshold)
+            {
+                enemy_shoot(enemies, i, bullets, &game->rng);
+            }
+        }
+
+        profiler_end(game->profiler, PROFILE_ENEMY_AI);
+        profiler_begin(game->profiler, PROFILE_BULLETS);
+
+        bullet_pool_update(bullets, dt, enemy_dt, game->screen_height);
+
+        for (int i = 0; i < game->capacities.powerups; i++)
+        {
+            powerup_update(&game->powerups[i], dt, game->screen_height);
+        }
+
+        profiler_end(game->profiler, PROFILE_BULLETS);
+        profiler_begin(game->profiler, PROFILE_COLLISION);
+
+        collision_grid_build(&game->grid, enemies);
+
+        for (int d = bullets->count - 1; d >= 0; d--)
+        {
+            int i = bullets->dense[d];
+            if (bullets->info[i].is_player_bullet)
+            {
+                /* Broadphase: only enemies in nearby grid cells can be hit */
+                int *candidates = game->hit_candidates;
+                int candidate_count = collision_grid_query(&game->grid, collision_get_bullet_sweep_box(bullets, i),
+                                                           candidates, enemies->capacity);
+
+                /* Hit the lowest-index enemy, as a front-to-back scan would */
+                int j = -1;
+                for (int c = 0; c < candidate_count; c++)
+                {
+                    int candidate = candidates[c];
+                    if ((j < 0 || candidate < j) && collision_enemy_bullet(enemies, candidate, bullets, i))
+                        j = candidate;
+                }
+
+                if (j >= 0)
+                {
+                    int score = 100;
+                    if (enemies->info[j].type == ENEMY_BUTTERFLY)
+                        score = 150;
+                    if (enemies->info[j].type == ENEMY_BOSS)
+                        score = 300;
+
+                    if (enemies->info[j].type == ENEMY_BOSS && enemies->info[j].has_captured_player)
+                    {
+                        player_free(&game->player);
+                    }
+
+                    spawn_powerup(game->powerups, game->capacities.powerups, enemies->x[j], enemies->y[j], &game->rng);
+
+                    enemy_deactivate(enemies, j);
+                    bullet_release(bullets, i);
+
+                    /* Update combo system */
+                    game->player.combo_count++;
+                    game->player.combo_timer = 2.0f; /* Reset combo timer */
+                    if (game->player.combo_count >= 5)
+                        game->player.score_multiplier = 4;
+                    else if (game->player.combo_count >= 3)
+                        game->player.score_multiplier = 2;
+                    else
+                        game->player.score_multiplier = 1;
+
+                    /* Apply score with multiplier */
+                    game_state_add_score(&game->game_state, score * game->player.score_multiplier);
+                }
+            }
+            else
+            {
+                if (collision_player_bullet(&game->player, bullets, i))
+                {
+                    int lives = game->player.lives;
+                    player_hit(&game->player);
+                    if (game->player.lives < lives)
+                    {
+                        game_state_player_died(&game->game_state);
+                    }
+                    bullet_release(bullets, i);
+                }
+            }
+        }
+
+        for (int i = enemy_next(enemies, 0); i < enemies->capacity; i = enemy_next(enemies, i + 1))
+        {
+            if (collision_player_enemy(&game->player, enemies, i))
+            {
+                int lives = game->player.lives;
+                player_hit(&game->player);
+                if (game->player.lives < lives)
+                {
+                    game_state_player_died(&game->game_state);
+                }
+                if (!game->player.god_mode && !game->player.has_shield)
+                {
+                    enemy_deactivate(enemies, i);
+                }
+            }
+        }
+
+        for (int i = 0; i < game->capacities.powerups; i++)
+        {
+            if (collision_player_powerup(&game->player, &game->powerups[i]))
+            {
+                powerup_apply(&game->powerups[i], &game->player);
+            }
+        }
+
+        profiler_end(game->profiler, PROFILE_COLLISION);
+
+        if (enemy_ai_count_active(&game->formation) == 0)
+        {
+            game_state_complete_wave(&game->game_state, &game->player);
+            game_state_start_wave(&game->game_state, &game->formation, game->screen_width, game->screen_height);
+        }
+
+        if (game_state_is_game_over(&game->game_state, &game->player))
+        {
+            game->game_state.state = GAME_STATE_GAME_OVER;
+        }
+    }
+    else if (game->game_state.state == GAME_STATE_BONUS_STAGE)
+    {
+        profiler_begin(game->profiler, PROFILE_ENEMY_AI);
+
+        if (game->bonus_stage.active == false || game->bonus_stage.timer == BONUS_STAGE_DURATION)
+        {
+            bonus_stage_init(&game->bonus_stage, game->screen_width);
+        }
+
+        bonus_stage_update(&game->bonus_stage, enemy_dt, game->screen_width);
+
+        profiler_end(game->profiler, PROFILE_ENEMY_AI);
+        profiler_begin(game->profiler, PROFILE_PLAYER);
+
+        game->player.vx = 0.0f;
+        game->player.vy = 0.0f;
+        if (input->left)
+            game->player.vx = -1.0f;
+        if (input->right)
+            game->player.vx = 1.0f;
+        if (input->up)
+            game->player.vy = -1.0f;
+        if (input->down)
+            game->player.vy = 1.0f;
+        if (input->shoot)
+            player_shoot(&game->player, bullets);
+
+        player_update(&game->player, dt, game->screen_width, game->screen_height);
+
+        profiler_end(game->profiler, PROFILE_PLAYER);
+        profiler_begin(game->profiler, PROFILE_BULLETS);
+
+        bullet_pool_update(bullets, dt, enemy_dt, game->screen_height);
+
+        profiler_end(game->profiler, PROFILE_BULLETS);
+        profiler_begin(game->profiler, PROFILE_COLLISION);
+
+        EnemyPool *bonus_enemies = &game->bonus_stage.enemies;
+        for (int d = bullets->count - 1; d >= 0; d--)
+        {
+            int i = bullets->dense[d];
+            if (!bullets->info[i].is_player_bullet)
+                continue;
+
+            for (int j = enemy_next(bonus_enemies, 0); j < bonus_enemies->capacity;
+                 j = enemy_next(bonus_enemies, j + 1))
+            {
+                if (collision_enemy_bullet(bonus_enemies, j, bullets, i))
+                {
+                    enemy_deactivate(bonus_enemies, j);
+                    bullet_release(bullets, i);
+                    game->bonus_stage.enemies_destroyed++;
+                    game_state_add_score(&game->game_state, 500);
+                    break;
+                }
+            }
+        }
+
+        profiler_end(game->profiler, PROFILE_COLLISION);
+
+        if (bonus_stage_is_complete(&game->bonus_stage))
+        {
+            int bonus_score = bonus_stage_calculate_score(&game->bonus_stage);
+            game_state_add_score(&game->game_state, bonus_score);
+            game_state_start_wave(&game->game_state, &game->formation, game->screen_width, game->screen_height);
+        }
+    }
+    game_state_update(&game->game_state, dt);
+}
+
+void game_render(Game *game, TerminalBuffer *buf, float alpha)
+{
+    if (game->game_state.state == GAME_STATE_MENU)
+    {
+        renderer_draw_menu(buf, game->screen_width, game->screen_height);
+    }
+    else if (game->game_state.state == GAME_STATE_WAVE_TRANSITION)
+    {
+        renderer_draw_stars(buf, game->stars, game->capacities.stars);
+        renderer_draw_wave_transition(buf, &game->game_state, game->screen_width, game->screen_height);
+    }
+    else if (game->game_state.state == GAME_STATE_PLAYING)
+    {
+        renderer_draw_stars(buf, game->stars, game->capacities.stars);
+
+        renderer_draw_enemies(buf, &game->formation.enemies, alpha);
+        renderer_draw_bullets(buf, &game->bullets, alpha);
+
+        for (int i = 0; i < game->capacities.powerups; i++)
+        {
+            renderer_draw_powerup(buf, &game->powerups[i]);
+        }
+
+        renderer_draw_player(buf, &game->player, alpha);
+        renderer_draw_hud(buf, &game->player, &game->game_state);
+    }
+    else if (game->game_state.state == GAME_STATE_BONUS_STAGE)
+    {
+        renderer_draw_stars(buf, game->stars, game->capacities.stars);
+
+        renderer_draw_enemies(buf, &game->bonus_stage.enemies, alpha);
+        renderer_draw_bullets(buf, &game->bullets, alpha);
+
+        renderer_draw_player(buf, &game->player, alpha);
+        renderer_draw_bonus_stage_hud(buf, &game->bonus_stage, &game->game_state);
+    }
+    else if (game->game_state.state == GAME_STATE_GAME_OVER)
+    {
+        renderer_draw_stars(buf, game->stars, game->capacities.stars);
+        renderer_draw_game_over(buf, &game->game_state, game->screen_width, game->screen_height);
+    }
+}
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t hash_position(uint64_t hash, bool active, float x, float y)
+{
+    if (!active)
+        return hash_bytes(hash, &active, sizeof(active));
+
+    hash = hash_bytes(hash, &x, sizeof(x));
+    return hash_bytes(hash, &y, sizeof(y));
+}
+
+/* Fingerprint of the simulation state, for checking that a replay reproduced a run */
+uint64_t game_checksum(Game *game)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    hash = hash_bytes(hash, &game->rng.state, sizeof(game->rng.state));
+    hash = hash_bytes(hash, &game->game_state.state, sizeof(game->game_state.state));
+    hash = hash_bytes(hash, &game->game_state.score, sizeof(game->game_state.score));
+    hash = hash_bytes(hash, &game->game_state.current_wave, sizeof(game->game_state.current_wave));
+    hash = hash_bytes(hash, &game->player.lives, sizeof(game->player.lives));
+    hash = hash_bytes(hash, &game->player.health, sizeof(game->player.health));
+    hash = hash_position(hash, true, game->player.x, game->player.y);
+
+    EnemyPool *enemies = &game->formation.enemies;
+    for (int i = 0; i < enemies->capacity; i++)
+        hash = hash_position(hash, enemy_is_active(enemies, i), enemies->x[i], enemies->y[i]);
+
+    BulletPool *bullets = &game->bullets;
+    for (int i = 0; i < bullets->capacity; i++)
+        hash = hash_position(hash, bullet_is_active(bullets, i), bullets->x[i], bullets->y[i]);
+
+    return hash;
+}
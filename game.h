@@ -0,0 +1,42 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "terminal.h"
+#include "input.h"
+#include "entities.h"
+#include "enemy_ai.h"
+#include "game_state.h"
+#include "bonus_stage.h"
+#include "rng.h"
+#include "collision.h"
+#include "arena.h"
+#include "profiler.h"
+
+typedef struct
+{
+    int screen_width;
+    int screen_height;
+    bool started;
+    EntityCapacities capacities;
+    Arena arena; /* Backs all entity storage below */
+    Rng rng;
+    Player player;
+    BulletPool bullets;
+    PowerUp *powerups;
+    Star *stars;
+    GameState game_state;
+    EnemyFormation formation;
+    BonusStage bonus_stage;
+    CollisionGrid grid;
+    int *hit_candidates; /* Broadphase query results, one per enemy */
+    Profiler *profiler;  /* Phase timings, or NULL when not profiling */
+} Game;
+
+bool game_init(Game *game, int screen_width, int screen_height, const EntityCapacities *capacities, uint64_t seed);
+void game_reset(Game *game, uint64_t seed);
+void game_free(Game *game);
+void game_update(Game *game, InputState *input, float dt);
+void game_render(Game *game, TerminalBuffer *buf, float alpha);
+uint64_t game_checksum(Game *game);
+
+#endif
@@ -1,4 +1,5 @@
 #include "game_state.h"
+#include "trace.h"
 
 #define WAVE_TRANSITION_TIME 3.0f
 #define GAME_OVER_TIME 3.0f
@@ -36,7 +37,7 @@ void game_state_update(GameState *state, float dt)
     }
 }
 
-void game_state_start_wave(GameState *state, EnemyFormation *formation, int screen_width)
+void game_state_start_wave(GameState *state, EnemyFormation *formation, int screen_width, int screen_height)
 {
     state->current_wave++;
     state->wave_complete = false;
@@ -46,10 +47,12 @@ void game_state_start_wave(GameState *state, EnemyFormation *formation, int scre
     if (game_state_should_spawn_bonus_stage(state))
     {
         state->state = GAME_STATE_BONUS_STAGE;
+        trace_instant("bonus stage", "wave", state->current_wave);
     }
     else
     {
-        enemy_ai_init_formation(formation, screen_width, state->current_wave);
+        enemy_ai_init_formation(formation, screen_width, screen_height, state->current_wave);
+        trace_instant("wave start", "wave", state->current_wave);
         state->state = GAME_STATE_WAVE_TRANSITION;
         state->wave_transition_timer = WAVE_TRANSITION_TIME;
     }
@@ -78,6 +81,7 @@ void game_state_add_score(GameState *state, int points)
 void game_state_player_died(GameState *state)
 {
     state->perfect_wave = false;
+    trace_instant("player died", "wave", state->current_wave);
 }
 
 bool game_state_should_spawn_bonus_stage(GameState *state)
@@ -91,6 +95,7 @@ bool game_state_is_game_over(GameState *state, Player *player)
     {
         state->state = GAME_STATE_GAME_OVER;
         state->game_over_timer = GAME_OVER_TIME;
+        trace_instant("game over", "score", state->score);
         return true;
     }
     return state->state == GAME_STATE_GAME_OVER && state->game_over_timer <= 0.0f;
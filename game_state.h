@@ -29,7 +29,7 @@ typedef struct
 
 void game_state_init(GameState *state);
 void game_state_update(GameState *state, float dt);
-void game_state_start_wave(GameState *state, EnemyFormation *formation, int screen_width);
+void game_state_start_wave(GameState *state, EnemyFormation *formation, int screen_width, int screen_height);
 void game_state_complete_wave(GameState *state, Player *player);
 void game_state_add_score(GameState *state, int points);
 void game_state_player_died(GameState *state);
@@ -0,0 +1,185 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "headless.h"
+#include "game.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Scripted input pattern, in ticks */
+#define SCRIPT_SWEEP_PERIOD 90
+#define SCRIPT_SPECIAL_PERIOD 300
+#define SCRIPT_BOMB_PERIOD 600
+
+/* Sweep left and right while holding fire, using specials and bombs periodically */
+static void headless_script_input(InputState *input, long tick)
+{
+    bool sweep_right = (tick % SCRIPT_SWEEP_PERIOD) < SCRIPT_SWEEP_PERIOD / 2;
+
+    input->left = !sweep_right;
+    input->right = sweep_right;
+    input->up = false;
+    input->down = false;
+    input->shoot = true;
+    input->quit = false;
+    input->god_toggle = false;
+    input->special = (tick % SCRIPT_SPECIAL_PERIOD) == 0;
+    input->bomb = (tick % SCRIPT_BOMB_PERIOD) == 0;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* Input comes from the replay when one is given, otherwise from the built-in script; a snapshot sets the first game */
+int headless_run(const GameOptions *options, Replay *replay, const Snapshot *snapshot)
+{
+    /* Each restarted game gets the next seed, so a soak run is reproducible from its first seed */
+    uint64_t seed = options->seed;
+
+    Game *game = malloc(sizeof(Game));
+    if (!game || !game_init(game, options->width, options->height, &options->capacities, seed))
+    {
+        fprintf(stderr, "Failed to allocate game state.\n");
+        free(game);
+        return 1;
+    }
+
+    if (snapshot && !snapshot_restore(snapshot, game))
+    {
+        fprintf(stderr, "Snapshot %s was saved by a different build.\n", options->load_snapshot_path);
+        game_free(game);
+        free(game);
+        return 1;
+    }
+
+    Replay *recorder = NULL;
+    if (options->record_path)
+    {
+        ReplayHeader header = {options->seed, options->tick_rate, options->width, options->height,
+                               options->capacities};
+        recorder = replay_create(options->record_path, &header);
+        if (!recorder)
+        {
+            fprintf(stderr, "Failed to create recording %s.\n", options->record_path);
+            game_free(game);
+            free(game);
+            return 1;
+        }
+    }
+
+    /* Each tick counts as a frame; there is no input, render or flush phase */
+    Profiler *profiler = NULL;
+    if (options->profile_path || options->trace_path)
+    {
+        profiler = profiler_create();
+        if (!profiler)
+        {
+            fprintf(stderr, "Failed to allocate profiler.\n");
+            replay_close(recorder);
+            game_free(game);
+            free(game);
+            return 1;
+        }
+        game->profiler = profiler;
+    }
+
+    if (options->trace_path && !trace_open(options->trace_path))
+    {
+        fprintf(stderr, "Failed to create trace %s.\n", options->trace_path);
+        profiler_destroy(profiler);
+        replay_close(recorder);
+        game_free(game);
+        free(game);
+        return 1;
+    }
+
+    InputState input = {0};
+    float tick_dt = 1.0f / options->tick_rate;
+
+    long games_played = 1;
+    int max_wave = 0;
+    long long total_score = 0;
+
+    double start = now_seconds();
+
+    long tick;
+    for (tick = 0; tick < options->ticks; tick++)
+    {
+        if (replay)
+        {
+            if (!replay_next(replay, &input))
+                break;
+        }
+        else
+        {
+            headless_script_input(&input, tick);
+        }
+
+        replay_record(recorder, &input);
+        game_update(game, &input, tick_dt);
+        profiler_end_frame(profiler);
+
+        if (game->game_state.current_wave > max_wave)
+            max_wave = game->game_state.current_wave;
+
+        /* Start a new game once the game over screen has run its course */
+        if (game->game_state.state == GAME_STATE_GAME_OVER && game->game_state.game_over_timer <= 0.0f)
+        {
+            total_score += game->game_state.score;
+            game_reset(game, ++seed);
+            games_played++;
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+    total_score += game->game_state.score;
+
+    printf("seed:         %llu\n", (unsigned long long)options->seed);
+    printf("ticks:        %ld\n", tick);
+    printf("elapsed:      %.3f s\n", elapsed);
+    /* Rates are meaningless when nothing ran, e.g. an empty replay or --ticks 0 */
+    if (tick > 0)
+    {
+        printf("ticks/sec:    %.0f\n", tick / elapsed);
+        printf("ns/tick:      %.1f\n", elapsed * 1e9 / tick);
+    }
+    printf("games:        %ld\n", games_played);
+    printf("max wave:     %d\n", max_wave);
+    printf("total score:  %lld\n", total_score);
+    printf("checksum:     %016llx\n", (unsigned long long)game_checksum(game));
+
+    int status = 0;
+    if (options->save_snapshot_path)
+    {
+        Snapshot *final = snapshot_create(game);
+        if (final)
+            snapshot_capture(final, game);
+        if (!final || !snapshot_write(final, options->save_snapshot_path))
+        {
+            fprintf(stderr, "Failed to save snapshot %s.\n", options->save_snapshot_path);
+            status = 1;
+        }
+        snapshot_destroy(final);
+    }
+    if (options->profile_path && !profiler_dump(profiler, options->profile_path))
+    {
+        fprintf(stderr, "Failed to write profile %s.\n", options->profile_path);
+        status = 1;
+    }
+    if (!trace_close())
+    {
+        fprintf(stderr, "Failed to write trace %s.\n", options->trace_path);
+        status = 1;
+    }
+
+    profiler_destroy(profiler);
+    replay_close(recorder);
+    game_free(game);
+    free(game);
+    return status;
+}
@@ -0,0 +1,10 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "options.h"
+#include "replay.h"
+#include "snapshot.h"
+
+int headless_run(const GameOptions *options, Replay *replay, const Snapshot *snapshot);
+
+#endif
@@ -6,7 +6,14 @@
 /* Input timing constants */
 #define KEY_HOLD_TIME 0.75f
 
+#define ESCAPE_CHAR 27
+
+/* A control sequence's parameter and intermediate bytes run up to a final byte in this range */
+#define CSI_FINAL_MIN 0x40
+#define CSI_FINAL_MAX 0x7e
+
 static int original_flags = 0;
+static bool in_control_sequence = false; /* The last read stopped partway through a control sequence */
 
 void input_init(void)
 {
@@ -19,56 +26,110 @@ void input_cleanup(void)
     fcntl(STDIN_FILENO, F_SETFL, original_flags);
 }
 
-KeyCode input_read_key(void)
+static bool read_byte(char *byte)
+{
+    return read(STDIN_FILENO, byte, 1) == 1;
+}
+
+/* Consume the rest of a control sequence; false if input ran out before its final byte */
+static bool skip_control_sequence(void)
 {
-    char buf[3];
-    int n = read(STDIN_FILENO, buf, sizeof(buf));
+    char byte;
+    while (read_byte(&byte))
+    {
+        if (byte >= CSI_FINAL_MIN && byte <= CSI_FINAL_MAX)
+        {
+            in_control_sequence = false;
+            return true;
+        }
+    }
+    in_control_sequence = true;
+    return false;
+}
 
-    if (n <= 0)
+static KeyCode key_from_char(char ch)
+{
+    switch (ch)
+    {
+    case ' ':
+        return KEY_SPACE;
+    case 'q':
+    case 'Q':
+        return KEY_Q;
+    case 'w':
+    case 'W':
+        return KEY_W;
+    case 'a':
+    case 'A':
+        return KEY_A;
+    case 's':
+    case 'S':
+        return KEY_S;
+    case 'd':
+    case 'D':
+        return KEY_D;
+    case 'g':
+    case 'G':
+        return KEY_G;
+    case 'b':
+    case 'B':
+        return KEY_B;
+    case 'x':
+    case 'X':
+        return KEY_X;
+    case 'p':
+    case 'P':
+        return KEY_P;
+    case 'r':
+    case 'R':
+        return KEY_R;
+    case '-':
+    case '_':
+        return KEY_MINUS;
+    case '+':
+    case '=':
+        return KEY_PLUS;
+    default:
         return KEY_NONE;
+    }
+}
 
-    /* Single character keys */
-    if (n == 1)
+/*
+ * Next recognised key, or KEY_NONE once input runs dry. Control sequences
+ * other than the arrow keys, such as a terminal's late answer to a startup
+ * query, are dropped whole, even when they arrive split across reads, so
+ * their bytes are never taken for keys.
+ */
+KeyCode input_read_key(void)
+{
+    char byte;
+    for (;;)
     {
-        switch (buf[0])
+        if (in_control_sequence && !skip_control_sequence())
+            return KEY_NONE;
+        if (!read_byte(&byte))
+            return KEY_NONE;
+
+        if (byte != ESCAPE_CHAR)
         {
-        case ' ':
-            return KEY_SPACE;
-        case 'q':
-        case 'Q':
-            return KEY_Q;
-        case 'w':
-        case 'W':
-            return KEY_W;
-        case 'a':
-        case 'A':
-            return KEY_A;
-        case 's':
-        case 'S':
-            return KEY_S;
-        case 'd':
-        case 'D':
-            return KEY_D;
-        case 'g':
-        case 'G':
-            return KEY_G;
-        case 'b':
-        case 'B':
-            return KEY_B;
-        case 'x':
-        case 'X':
-            return KEY_X;
-        case 27:
+            KeyCode key = key_from_char(byte);
+            if (key != KEY_NONE)
+                return key;
+            continue;
+        }
+
+        /* A lone escape is the Esc key */
+        if (!read_byte(&byte) || byte != '[')
             return KEY_ESC;
-        default:
-            return KEY_NONE;
+
+        if (!read_byte(&byte))
+        {
+            in_control_sequence = true;
+            continue;
         }
-    }
 
-    /* Arrow key escape sequences */
-    if (n >= 3 && buf[0] == 27 && buf[1] == '[')
-    {
-        switch (buf[2])
+        /* Arrow key escape sequences */
+        switch (byte)
         {
         case 'A':
             return KEY_UP;
@@ -79,11 +140,12 @@ KeyCode input_read_key(void)
         case 'D':
             return KEY_LEFT;
         default:
-            return KEY_NONE;
+            break;
         }
-    }
 
-    return KEY_NONE;
+        if (byte < CSI_FINAL_MIN || byte > CSI_FINAL_MAX)
+            skip_control_sequence();
+    }
 }
 
 void input_update_state(InputState *state, float dt)
@@ -127,6 +189,18 @@ void input_update_state(InputState *state, float dt)
         case KEY_X:
             state->special = true;
             break;
+        case KEY_P:
+            state->profiler_toggle = true;
+            break;
+        case KEY_R:
+            state->rewind = true;
+            break;
+        case KEY_MINUS:
+            state->time_slower = true;
+            break;
+        case KEY_PLUS:
+            state->time_faster = true;
+            break;
         case KEY_Q:
         case KEY_ESC:
             state->quit = true;
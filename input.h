@@ -19,6 +19,10 @@ typedef enum
     KEY_G,
     KEY_B,
     KEY_X,
+    KEY_P,
+    KEY_R,
+    KEY_MINUS,
+    KEY_PLUS,
     KEY_ESC
 } KeyCode;
 
@@ -33,6 +37,10 @@ typedef struct
     bool god_toggle;
     bool bomb;
     bool special;
+    bool profiler_toggle;
+    bool time_slower; /* Halve the time scale */
+    bool time_faster; /* Double the time scale */
+    bool rewind;      /* Go back to the last checkpoint */
     float up_time;
     float down_time;
     float left_time;
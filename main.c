@@ -2,28 +2,31 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <signal.h>
 #include <unistd.h>
 #include "terminal.h"
 #include "input.h"
-#include "entities.h"
-#include "collision.h"
-#include "enemy_ai.h"
-#include "game_state.h"
-#include "bonus_stage.h"
+#include "game.h"
+#include "options.h"
 #include "renderer.h"
+#include "headless.h"
+#include "replay.h"
+#include "profiler.h"
+#include "trace.h"
+#include "snapshot.h"
+#include "output_thread.h"
 
 /* Game timing constants */
-#define TARGET_FPS 30
-#define FRAME_TIME (1.0f / TARGET_FPS)
 #define MAX_FRAME_TIME 0.1f
+#define NANOSECONDS_PER_SECOND 1000000000L
 
-/* Gameplay constants */
-#define POWERUP_DROP_CHANCE 15
-#define ENEMY_SHOOT_CHANCE 5
-#define ENEMY_SHOOT_CHANCE_DIVISOR 1000
-#define BULLET_SPEED 30.0f
+/* Simulated seconds between the checkpoints R rewinds to */
+#define CHECKPOINT_INTERVAL 5.0f
+
+/* Room for an error message that names a file, kept until the terminal is restored */
+#define FAILURE_MESSAGE_SIZE 512
 
 static volatile bool running = true;
 
@@ -50,434 +53,381 @@ float get_delta_time(struct timespec *last_time)
     return dt;
 }
 
-void spawn_powerup(PowerUp powerups[], int max_powerups, float x, float y)
+static void timespec_add_ns(struct timespec *ts, long ns)
 {
-    /* Random chance to drop a power-up */
-    if (rand() % 100 < POWERUP_DROP_CHANCE)
+    ts->tv_nsec += ns;
+    while (ts->tv_nsec >= NANOSECONDS_PER_SECOND)
     {
-        for (int i = 0; i < max_powerups; i++)
-        {
-            if (!powerups[i].active)
-            {
-                /* Weighted random selection of powerup types */
-                int roll = rand() % 100;
-                PowerUpType type;
-
-                if (roll < 15)
-                    type = POWERUP_DUAL_SHOT;
-                else if (roll < 30)
-                    type = POWERUP_SHIELD;
-                else if (roll < 40)
-                    type = POWERUP_SPEED;
-                else if (roll < 50)
-                    type = POWERUP_MEGA_LASER;
-                else if (roll < 60)
-                    type = POWERUP_BOMB;
-                else if (roll < 70)
-                    type = POWERUP_HOMING;
-                else if (roll < 78)
-                    type = POWERUP_LIGHTNING;
-                else if (roll < 86)
-                    type = POWERUP_REFLECT_SHIELD;
-                else if (roll < 94)
-                    type = POWERUP_TIME_SLOW;
-                else
-                    type = POWERUP_ALLY_DRONE; /* Rarest powerup */
-
-                powerup_init(&powerups[i], x, y, type);
-                break;
-            }
-        }
+        ts->tv_nsec -= NANOSECONDS_PER_SECOND;
+        ts->tv_sec++;
     }
 }
 
-int main(void)
+static bool timespec_before(const struct timespec *a, const struct timespec *b)
 {
-    srand(time(NULL));
-    setup_signal_handlers();
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
 
-    terminal_init();
-    input_init();
+/* Sleep until the next frame deadline; resynchronize if we are more than a frame late */
+static void wait_for_deadline(struct timespec *deadline, long frame_ns)
+{
+    timespec_add_ns(deadline, frame_ns);
 
-    int screen_width, screen_height;
-    terminal_get_size(&screen_width, &screen_height);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    if (!terminal_validate_size())
+    struct timespec late_limit = *deadline;
+    timespec_add_ns(&late_limit, frame_ns);
+    if (timespec_before(&late_limit, &now))
     {
-        terminal_cleanup();
-        fprintf(stderr, "Terminal too small. Need at least 80x24.\n");
-        return 1;
+        *deadline = now;
+        return;
     }
 
-    TerminalBuffer *buffer = terminal_buffer_create(screen_width, screen_height);
-    if (!buffer)
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) != 0 && running)
+        ;
+}
+
+/* Whether --fast-forward or --skip-to-wave still wants ticks run unthrottled */
+static bool fast_forward_pending(const GameOptions *options, const Game *game, long ticks_run)
+{
+    if (ticks_run < options->fast_forward_ticks)
+        return true;
+
+    const GameState *state = &game->game_state;
+    return state->current_wave < options->skip_to_wave && state->state != GAME_STATE_GAME_OVER;
+}
+
+int main(int argc, char **argv)
+{
+    GameOptions options;
+    options_init(&options);
+    if (!options_parse(&options, argc, argv))
     {
-        terminal_cleanup();
-        fprintf(stderr, "Failed to create terminal buffer.\n");
+        options_print_usage(argv[0]);
         return 1;
     }
+    if (options.show_help)
+    {
+        options_print_usage(argv[0]);
+        return 0;
+    }
 
-    Player player;
-    player_init(&player, screen_width, screen_height);
+    /* A replay brings its own seed, tick rate, playfield size and capacities */
+    Replay *replay = NULL;
+    if (options.replay_path)
+    {
+        replay = replay_open(options.replay_path);
+        if (!replay)
+        {
+            fprintf(stderr, "Failed to open replay %s.\n", options.replay_path);
+            return 1;
+        }
+        options.seed = replay->header.seed;
+        options.tick_rate = replay->header.tick_rate;
+        options.width = replay->header.width;
+        options.height = replay->header.height;
+        options.capacities = replay->header.capacities;
+    }
 
-    Bullet bullets[MAX_BULLETS] = {0};
-    PowerUp powerups[MAX_POWERUPS] = {0};
-    Star stars[MAX_STARS];
-    stars_init(stars, MAX_STARS, screen_width, screen_height);
+    /* So does a snapshot, which must agree with the replay if both are given */
+    Snapshot *snapshot = NULL;
+    if (options.load_snapshot_path)
+    {
+        snapshot = snapshot_read(options.load_snapshot_path);
+        if (!snapshot)
+        {
+            fprintf(stderr, "Failed to load snapshot %s.\n", options.load_snapshot_path);
+            replay_close(replay);
+            return 1;
+        }
+        const SnapshotHeader *header = &snapshot->header;
+        if (replay && (header->width != options.width || header->height != options.height ||
+                       memcmp(&header->capacities, &options.capacities, sizeof(EntityCapacities)) != 0))
+        {
+            fprintf(stderr, "Snapshot %s does not match the replay's playfield.\n", options.load_snapshot_path);
+            snapshot_destroy(snapshot);
+            replay_close(replay);
+            return 1;
+        }
+        options.width = header->width;
+        options.height = header->height;
+        options.capacities = header->capacities;
+    }
 
-    GameState game_state;
-    game_state_init(&game_state);
+    if (options.headless)
+    {
+        int status = headless_run(&options, replay, snapshot);
+        snapshot_destroy(snapshot);
+        replay_close(replay);
+        return status;
+    }
 
-    EnemyFormation formation = {0};
-    BonusStage bonus_stage = {0};
+    setup_signal_handlers();
 
-    InputState input = {0};
-    input.up_time = 0.0f;
-    input.down_time = 0.0f;
-    input.left_time = 0.0f;
-    input.right_time = 0.0f;
-    input.shoot_time = 0.0f;
+    terminal_init();
+    input_init();
 
-    struct timespec last_time;
-    clock_gettime(CLOCK_MONOTONIC, &last_time);
+    /* From here on every exit goes through cleanup, which releases whatever has been set up so far */
+    int status = 1;
+    char failure[FAILURE_MESSAGE_SIZE] = "";
+    Replay *recorder = NULL;
+    TerminalBuffer *buffer = NULL;
+    Game game = {0};
+    Profiler *profiler = NULL;
+    Snapshot *checkpoint = NULL;
+    OutputThread *output = NULL;
+    bool played = false;
 
-    bool game_started = false;
+    int screen_width, screen_height;
+    terminal_get_size(&screen_width, &screen_height);
 
-    while (running)
+    if (!terminal_validate_size())
     {
-        float dt = get_delta_time(&last_time);
-        if (dt > MAX_FRAME_TIME)
-            dt = MAX_FRAME_TIME;
+        snprintf(failure, sizeof(failure), "Terminal too small. Need at least 80x24.");
+        goto cleanup;
+    }
 
-        input.god_toggle = false;
-        input.bomb = false;
-        input.special = false;
-        input_update_state(&input, dt);
+    /* The simulation keeps the recorded or saved playfield even if the terminal differs */
+    int game_width = replay || snapshot ? options.width : screen_width;
+    int game_height = replay || snapshot ? options.height : screen_height;
 
-        if (input.god_toggle)
+    if (options.record_path)
+    {
+        ReplayHeader header = {options.seed, options.tick_rate, game_width, game_height, options.capacities};
+        recorder = replay_create(options.record_path, &header);
+        if (!recorder)
         {
-            player.god_mode = !player.god_mode;
+            snprintf(failure, sizeof(failure), "Failed to create recording %s.", options.record_path);
+            goto cleanup;
         }
+    }
 
-        if (input.quit)
-        {
-            running = false;
-            break;
-        }
+    /* Drawn into here and encoded by the output thread, which keeps the front copy and output buffer */
+    buffer = terminal_buffer_create_cells(screen_width, screen_height);
+    if (!buffer)
+    {
+        snprintf(failure, sizeof(failure), "Failed to create terminal buffer.");
+        goto cleanup;
+    }
+
+    buffer->half_block = options.half_block;
+
+    if (!game_init(&game, game_width, game_height, &options.capacities, options.seed))
+    {
+        snprintf(failure, sizeof(failure), "Failed to allocate game state.");
+        goto cleanup;
+    }
 
-        if (game_state.state == GAME_STATE_MENU)
+    if (snapshot)
+    {
+        bool restored = snapshot_restore(snapshot, &game);
+        snapshot_destroy(snapshot);
+        snapshot = NULL;
+        if (!restored)
         {
-            if (input.shoot && !game_started)
-            {
-                game_started = true;
-                game_state_start_wave(&game_state, &formation, screen_width);
-            }
+            snprintf(failure, sizeof(failure), "Snapshot %s was saved by a different build.",
+                     options.load_snapshot_path);
+            goto cleanup;
         }
-        else if (game_state.state == GAME_STATE_PLAYING)
-        {
-            player.vx = 0.0f;
-            player.vy = 0.0f;
-
-            if (input.left)
-                player.vx = -1.0f;
-            if (input.right)
-                player.vx = 1.0f;
-            if (input.up)
-                player.vy = -1.0f;
-            if (input.down)
-                player.vy = 1.0f;
-            if (input.shoot)
-                player_shoot(&player, bullets, MAX_BULLETS);
-
-            /* Handle bomb */
-            if (input.bomb && player.bomb_count > 0)
-            {
-                player.bomb_count--;
-                /* Clear all enemies on screen */
-                for (int i = 0; i < MAX_ENEMIES; i++)
-                {
-                    if (formation.enemies[i].active)
-                    {
-                        int score = 50; /* Reduced score for bomb kills */
-                        if (formation.enemies[i].type == ENEMY_BUTTERFLY)
-                            score = 75;
-                        if (formation.enemies[i].type == ENEMY_BOSS)
-                            score = 150;
-                        formation.enemies[i].active = false;
-                        game_state_add_score(&game_state, score);
-                    }
-                }
-                /* Clear all enemy bullets */
-                for (int i = 0; i < MAX_BULLETS; i++)
-                {
-                    if (bullets[i].active && !bullets[i].is_player_bullet)
-                        bullets[i].active = false;
-                }
-            }
+    }
 
-            /* Handle special weapon */
-            if (input.special && player.special_ready)
-            {
-                player.special_ready = false;
-                player.special_charge = 0.0f;
-                /* Fire a spread of mega lasers */
-                int spread_count = 0;
-                for (int i = 0; i < MAX_BULLETS && spread_count < 5; i++)
-                {
-                    if (!bullets[i].active)
-                    {
-                        float angle = -0.4f + (spread_count * 0.2f);
-                        bullet_init_special(&bullets[i], player.x, player.y - 1.0f, angle * BULLET_SPEED, -BULLET_SPEED,
-                                            true, BULLET_MEGA_LASER);
-                        bullets[i].pierce_count = 10; /* Super pierce */
-                        spread_count++;
-                    }
-                }
-            }
+    /* Always on, so the overlay can be shown at any time; the timers cost a few clock reads per tick */
+    profiler = profiler_create();
+    if (!profiler)
+    {
+        snprintf(failure, sizeof(failure), "Failed to allocate profiler.");
+        goto cleanup;
+    }
+    game.profiler = profiler;
 
-            player_update(&player, dt, screen_width, screen_height);
+    if (options.trace_path && !trace_open(options.trace_path))
+    {
+        snprintf(failure, sizeof(failure), "Failed to create trace %s.", options.trace_path);
+        goto cleanup;
+    }
 
-            enemy_ai_update_formation(&formation, dt, screen_width);
-            enemy_ai_trigger_dive(&formation, &player, screen_height);
-            enemy_ai_trigger_capture(&formation, &player);
-            enemy_ai_update_dives(&formation, dt, &player, screen_height);
+    /* Rewinding would desynchronize a recording or replay, so it is only offered in free play */
+    if (!recorder && !replay)
+    {
+        checkpoint = snapshot_create(&game);
+        if (!checkpoint)
+        {
+            snprintf(failure, sizeof(failure), "Failed to allocate checkpoint.");
+            goto cleanup;
+        }
+        snapshot_capture(checkpoint, &game);
+    }
+    long checkpoint_ticks = (long)(CHECKPOINT_INTERVAL * options.tick_rate);
 
-            for (int i = 0; i < MAX_ENEMIES; i++)
-            {
-                enemy_update(&formation.enemies[i], dt);
+    /* Frames are encoded and written on their own thread, so a slow link never holds up the simulation */
+    output = output_thread_create(buffer);
+    if (!output)
+    {
+        snprintf(failure, sizeof(failure), "Failed to start output thread.");
+        goto cleanup;
+    }
 
-                if (formation.enemies[i].active && formation.enemies[i].state == ENEMY_STATE_FORMATION &&
-                    rand() % ENEMY_SHOOT_CHANCE_DIVISOR < ENEMY_SHOOT_CHANCE)
-                {
-                    enemy_shoot(&formation.enemies[i], bullets, MAX_BULLETS);
-                }
-            }
+    InputState input = {0};
+    input.up_time = 0.0f;
+    input.down_time = 0.0f;
+    input.left_time = 0.0f;
+    input.right_time = 0.0f;
+    input.shoot_time = 0.0f;
+    InputState replay_input = {0};
 
-            for (int i = 0; i < MAX_BULLETS; i++)
-            {
-                bullet_update(&bullets[i], dt, screen_height);
-            }
+    /* Simulation runs in fixed steps; rendering happens once per frame deadline */
+    float tick_dt = 1.0f / options.tick_rate;
+    long frame_ns = NANOSECONDS_PER_SECOND / options.render_rate;
+    float accumulator = 0.0f;
+    float time_scale = options.time_scale;
+    long ticks_run = 0;
+    bool fast_forwarding = fast_forward_pending(&options, &game, ticks_run);
 
-            for (int i = 0; i < MAX_POWERUPS; i++)
-            {
-                powerup_update(&powerups[i], dt, screen_height);
-            }
+    struct timespec last_time;
+    clock_gettime(CLOCK_MONOTONIC, &last_time);
+    struct timespec deadline = last_time;
 
-            for (int i = 0; i < MAX_BULLETS; i++)
-            {
-                if (!bullets[i].active)
-                    continue;
+    while (running)
+    {
+        float frame_time = get_delta_time(&last_time);
+        if (frame_time > MAX_FRAME_TIME)
+            frame_time = MAX_FRAME_TIME;
+        accumulator += frame_time * time_scale;
 
-                if (bullets[i].is_player_bullet)
-                {
-                    for (int j = 0; j < MAX_ENEMIES; j++)
-                    {
-                        if (collision_enemy_bullet(&formation.enemies[j], &bullets[i]))
-                        {
-                            int score = 100;
-                            if (formation.enemies[j].type == ENEMY_BUTTERFLY)
-                                score = 150;
-                            if (formation.enemies[j].type == ENEMY_BOSS)
-                                score = 300;
-
-                            if (formation.enemies[j].type == ENEMY_BOSS && formation.enemies[j].has_captured_player)
-                            {
-                                player_free(&player);
-                            }
-
-                            spawn_powerup(powerups, MAX_POWERUPS, formation.enemies[j].x, formation.enemies[j].y);
-
-                            formation.enemies[j].active = false;
-                            bullets[i].active = false;
-
-                            /* Update combo system */
-                            player.combo_count++;
-                            player.combo_timer = 2.0f; /* Reset combo timer */
-                            if (player.combo_count >= 5)
-                                player.score_multiplier = 4;
-                            else if (player.combo_count >= 3)
-                                player.score_multiplier = 2;
-                            else
-                                player.score_multiplier = 1;
-
-                            /* Apply score with multiplier */
-                            game_state_add_score(&game_state, score * player.score_multiplier);
-                            break;
-                        }
-                    }
-                }
-                else
-                {
-                    if (collision_player_bullet(&player, &bullets[i]))
-                    {
-                        player_hit(&player);
-                        if (player.health <= 0 && !player.god_mode)
-                        {
-                            game_state_player_died(&game_state);
-                        }
-                        bullets[i].active = false;
-                    }
-                }
-            }
+        /* Fast-forwarding runs ticks for one frame period of wall time, then draws a single frame */
+        struct timespec batch_end = last_time;
+        timespec_add_ns(&batch_end, frame_ns);
 
-            for (int i = 0; i < MAX_ENEMIES; i++)
+        while ((fast_forwarding || accumulator >= tick_dt) && running)
+        {
+            input.god_toggle = false;
+            input.bomb = false;
+            input.special = false;
+            input.profiler_toggle = false;
+            input.time_slower = false;
+            input.time_faster = false;
+            input.rewind = false;
+
+            profiler_begin(profiler, PROFILE_INPUT);
+            /* Held keys decay in wall-clock time, whatever the time scale */
+            input_update_state(&input, tick_dt / time_scale);
+
+            if (input.quit)
             {
-                if (formation.enemies[i].active && collision_player_enemy(&player, &formation.enemies[i]))
-                {
-                    player_hit(&player);
-                    if (player.health <= 0 && !player.god_mode)
-                    {
-                        game_state_player_died(&game_state);
-                    }
-                    if (!player.god_mode && !player.has_shield)
-                    {
-                        formation.enemies[i].active = false;
-                    }
-                }
+                /* Close the phase so the trace gets its span and the timer is left balanced */
+                profiler_end(profiler, PROFILE_INPUT);
+                running = false;
+                break;
             }
 
-            for (int i = 0; i < MAX_POWERUPS; i++)
+            if (input.profiler_toggle)
+                profiler->overlay_visible = !profiler->overlay_visible;
+            if (input.time_slower && time_scale > MIN_TIME_SCALE)
+                time_scale = time_scale / 2.0f < MIN_TIME_SCALE ? MIN_TIME_SCALE : time_scale / 2.0f;
+            if (input.time_faster && time_scale < MAX_TIME_SCALE)
+                time_scale = time_scale * 2.0f > MAX_TIME_SCALE ? MAX_TIME_SCALE : time_scale * 2.0f;
+            if (input.rewind && checkpoint)
+                snapshot_restore(checkpoint, &game);
+
+            /* Keyboard input still handles quitting while a replay plays */
+            InputState *tick_input = &input;
+            if (replay)
             {
-                if (collision_player_powerup(&player, &powerups[i]))
+                if (!replay_next(replay, &replay_input))
                 {
-                    powerup_apply(&powerups[i], &player);
+                    running = false;
+                    break;
                 }
+                tick_input = &replay_input;
             }
+            profiler_end(profiler, PROFILE_INPUT);
 
-            if (enemy_ai_count_active(&formation) == 0)
-            {
-                game_state_complete_wave(&game_state, &player);
-                game_state_start_wave(&game_state, &formation, screen_width);
-            }
-
-            if (game_state_is_game_over(&game_state, &player))
-            {
-                game_state.state = GAME_STATE_GAME_OVER;
-            }
-        }
-        else if (game_state.state == GAME_STATE_BONUS_STAGE)
-        {
-            if (bonus_stage.active == false || bonus_stage.timer == BONUS_STAGE_DURATION)
-            {
-                bonus_stage_init(&bonus_stage, screen_width);
-            }
-
-            bonus_stage_update(&bonus_stage, dt, screen_width);
-
-            player.vx = 0.0f;
-            player.vy = 0.0f;
-            if (input.left)
-                player.vx = -1.0f;
-            if (input.right)
-                player.vx = 1.0f;
-            if (input.up)
-                player.vy = -1.0f;
-            if (input.down)
-                player.vy = 1.0f;
-            if (input.shoot)
-                player_shoot(&player, bullets, MAX_BULLETS);
-
-            player_update(&player, dt, screen_width, screen_height);
+            replay_record(recorder, tick_input);
+            game_update(&game, tick_input, tick_dt);
+            ticks_run++;
+            if (checkpoint && ticks_run % checkpoint_ticks == 0)
+                snapshot_capture(checkpoint, &game);
 
-            for (int i = 0; i < MAX_BULLETS; i++)
+            if (!fast_forwarding)
             {
-                bullet_update(&bullets[i], dt, screen_height);
+                accumulator -= tick_dt;
+                continue;
             }
 
-            for (int i = 0; i < MAX_BULLETS; i++)
+            if (!fast_forward_pending(&options, &game, ticks_run))
             {
-                if (!bullets[i].active || !bullets[i].is_player_bullet)
-                    continue;
-
-                for (int j = 0; j < BONUS_ENEMIES; j++)
-                {
-                    if (collision_enemy_bullet(&bonus_stage.enemies[j], &bullets[i]))
-                    {
-                        bonus_stage.enemies[j].active = false;
-                        bullets[i].active = false;
-                        bonus_stage.enemies_destroyed++;
-                        game_state_add_score(&game_state, 500);
-                        break;
-                    }
-                }
+                fast_forwarding = false;
+                accumulator = 0.0f;
+                break;
             }
 
-            if (bonus_stage_is_complete(&bonus_stage))
-            {
-                int bonus_score = bonus_stage_calculate_score(&bonus_stage);
-                game_state_add_score(&game_state, bonus_score);
-                game_state_start_wave(&game_state, &formation, screen_width);
-            }
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (timespec_before(&batch_end, &now))
+                break;
         }
 
-        game_state_update(&game_state, dt);
+        if (!running)
+            break;
 
+        profiler_begin(profiler, PROFILE_RENDER);
         terminal_buffer_clear(buffer);
+        game_render(&game, buffer, fast_forwarding ? 1.0f : accumulator / tick_dt);
+        renderer_draw_time_scale(buffer, time_scale, fast_forwarding);
+        if (profiler->overlay_visible)
+            renderer_draw_profiler(buffer, profiler);
+        profiler_end(profiler, PROFILE_RENDER);
 
-        if (game_state.state == GAME_STATE_MENU)
-        {
-            renderer_draw_menu(buffer, screen_width, screen_height);
-        }
-        else if (game_state.state == GAME_STATE_WAVE_TRANSITION)
-        {
-            renderer_draw_stars(buffer, stars, MAX_STARS);
-            renderer_draw_wave_transition(buffer, &game_state, screen_width, screen_height);
-        }
-        else if (game_state.state == GAME_STATE_PLAYING)
-        {
-            renderer_draw_stars(buffer, stars, MAX_STARS);
-
-            for (int i = 0; i < MAX_ENEMIES; i++)
-            {
-                renderer_draw_enemy(buffer, &formation.enemies[i]);
-            }
-
-            for (int i = 0; i < MAX_BULLETS; i++)
-            {
-                renderer_draw_bullet(buffer, &bullets[i]);
-            }
-
-            for (int i = 0; i < MAX_POWERUPS; i++)
-            {
-                renderer_draw_powerup(buffer, &powerups[i]);
-            }
+        profiler_begin(profiler, PROFILE_FLUSH);
+        output_thread_submit(output, buffer);
+        profiler_end(profiler, PROFILE_FLUSH);
 
-            renderer_draw_player(buffer, &player);
-            renderer_draw_hud(buffer, &player, &game_state);
-        }
-        else if (game_state.state == GAME_STATE_BONUS_STAGE)
-        {
-            renderer_draw_stars(buffer, stars, MAX_STARS);
+        profiler_end_frame(profiler);
 
-            for (int i = 0; i < BONUS_ENEMIES; i++)
-            {
-                renderer_draw_enemy(buffer, &bonus_stage.enemies[i]);
-            }
-
-            for (int i = 0; i < MAX_BULLETS; i++)
-            {
-                renderer_draw_bullet(buffer, &bullets[i]);
-            }
+        if (!fast_forwarding)
+            wait_for_deadline(&deadline, frame_ns);
+    }
 
-            renderer_draw_player(buffer, &player);
-            renderer_draw_bonus_stage_hud(buffer, &bonus_stage, &game_state);
-        }
-        else if (game_state.state == GAME_STATE_GAME_OVER)
+    played = true;
+    status = 0;
+    if (options.save_snapshot_path)
+    {
+        Snapshot *final = snapshot_create(&game);
+        if (final)
+            snapshot_capture(final, &game);
+        if (!final || !snapshot_write(final, options.save_snapshot_path))
         {
-            renderer_draw_stars(buffer, stars, MAX_STARS);
-            renderer_draw_game_over(buffer, &game_state, screen_width, screen_height);
+            snprintf(failure, sizeof(failure), "Failed to save snapshot %s.", options.save_snapshot_path);
+            status = 1;
         }
-
-        terminal_buffer_flush(buffer);
-
-        /* Sleep to maintain target framerate */
-        struct timespec sleep_time = {.tv_sec = 0, .tv_nsec = (long)(FRAME_TIME * 1000000000)};
-        nanosleep(&sleep_time, NULL);
+        snapshot_destroy(final);
     }
 
+cleanup:
+    output_thread_destroy(output);
+    snapshot_destroy(checkpoint);
+    snapshot_destroy(snapshot);
+    game_free(&game);
+    replay_close(recorder);
+    replay_close(replay);
     terminal_buffer_destroy(buffer);
     input_cleanup();
     terminal_cleanup();
 
-    return 0;
+    if (failure[0] != '\0')
+        fprintf(stderr, "%s\n", failure);
+    if (played && options.profile_path && !profiler_dump(profiler, options.profile_path))
+    {
+        fprintf(stderr, "Failed to write profile %s.\n", options.profile_path);
+        status = 1;
+    }
+    if (!trace_close())
+    {
+        fprintf(stderr, "Failed to write trace %s.\n", options.trace_path);
+        status = 1;
+    }
+    profiler_destroy(profiler);
+
+    return status;
 }
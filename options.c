@@ -0,0 +1,294 @@
+#include "options.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <getopt.h>
+#include <time.h>
+#include "terminal.h"
+
+/* Long-only options */
+enum
+{
+    OPTION_MAX_ENEMIES = 256,
+    OPTION_MAX_BULLETS,
+    OPTION_MAX_POWERUPS,
+    OPTION_MAX_STARS,
+    OPTION_TIME_SCALE,
+    OPTION_FAST_FORWARD,
+    OPTION_SKIP_TO_WAVE,
+    OPTION_LOAD_SNAPSHOT,
+    OPTION_SAVE_SNAPSHOT,
+    OPTION_HALF_BLOCK
+};
+
+void options_init(GameOptions *options)
+{
+    options->tick_rate = DEFAULT_TICK_RATE;
+    options->render_rate = DEFAULT_RENDER_RATE;
+    options->show_help = false;
+    options->seed = (uint64_t)time(NULL);
+    options->record_path = NULL;
+    options->replay_path = NULL;
+    entity_capacities_default(&options->capacities);
+    options->profile_path = NULL;
+    options->trace_path = NULL;
+    options->time_scale = 1.0f;
+    options->fast_forward_ticks = 0;
+    options->skip_to_wave = 0;
+    options->load_snapshot_path = NULL;
+    options->save_snapshot_path = NULL;
+    options->half_block = false;
+    options->headless = false;
+    options->ticks = DEFAULT_HEADLESS_TICKS;
+    options->width = DEFAULT_HEADLESS_WIDTH;
+    options->height = DEFAULT_HEADLESS_HEIGHT;
+}
+
+static bool parse_long(const char *text, long min, long max, long *out)
+{
+    char *end;
+    long value = strtol(text, &end, 10);
+
+    if (end == text || *end != '\0' || value < min || value > max)
+        return false;
+
+    *out = value;
+    return true;
+}
+
+static bool parse_int(const char *text, int min, int max, int *out)
+{
+    long value;
+    if (!parse_long(text, min, max, &value))
+        return false;
+
+    *out = (int)value;
+    return true;
+}
+
+static bool parse_float(const char *text, float min, float max, float *out)
+{
+    char *end;
+    float value = strtof(text, &end);
+
+    if (end == text || *end != '\0' || !(value >= min && value <= max))
+        return false;
+
+    *out = value;
+    return true;
+}
+
+static bool parse_seed(const char *text, uint64_t *out)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 0);
+
+    if (end == text || *end != '\0')
+        return false;
+
+    *out = value;
+    return true;
+}
+
+/* Tick and frame rates the command line accepts, and which replay files are held to */
+bool options_rate_valid(int rate)
+{
+    return rate >= MIN_RATE && rate <= MAX_RATE;
+}
+
+/* Playfield sizes the command line accepts, and which replay and snapshot files are held to */
+bool options_size_valid(int width, int height)
+{
+    return width >= TERM_MIN_WIDTH && height >= TERM_MIN_HEIGHT && width <= MAX_SCREEN_SIZE &&
+           height <= MAX_SCREEN_SIZE;
+}
+
+/* Parse a "WIDTHxHEIGHT" screen size */
+static bool parse_size(const char *text, int *width, int *height)
+{
+    int w, h;
+    char trailing;
+
+    if (sscanf(text, "%dx%d%c", &w, &h, &trailing) != 2)
+        return false;
+    if (!options_size_valid(w, h))
+        return false;
+
+    *width = w;
+    *height = h;
+    return true;
+}
+
+static bool parse_capacity(int option, const char *text, EntityCapacities *capacities)
+{
+    int *capacity = &capacities->enemies;
+    if (option == OPTION_MAX_BULLETS)
+        capacity = &capacities->bullets;
+    else if (option == OPTION_MAX_POWERUPS)
+        capacity = &capacities->powerups;
+    else if (option == OPTION_MAX_STARS)
+        capacity = &capacities->stars;
+
+    return parse_int(text, 1, MAX_ENTITY_CAPACITY, capacity);
+}
+
+bool options_parse(GameOptions *options, int argc, char **argv)
+{
+    static const struct option long_options[] = {
+        {"tick-rate", required_argument, NULL, 't'},
+        {"fps", required_argument, NULL, 'f'},
+        {"seed", required_argument, NULL, 'r'},
+        {"record", required_argument, NULL, 'R'},
+        {"replay", required_argument, NULL, 'p'},
+        {"headless", no_argument, NULL, 'H'},
+        {"ticks", required_argument, NULL, 'n'},
+        {"size", required_argument, NULL, 's'},
+        {"max-enemies", required_argument, NULL, OPTION_MAX_ENEMIES},
+        {"max-bullets", required_argument, NULL, OPTION_MAX_BULLETS},
+        {"max-powerups", required_argument, NULL, OPTION_MAX_POWERUPS},
+        {"max-stars", required_argument, NULL, OPTION_MAX_STARS},
+        {"profile", required_argument, NULL, 'P'},
+        {"trace", required_argument, NULL, 'T'},
+        {"time-scale", required_argument, NULL, OPTION_TIME_SCALE},
+        {"fast-forward", required_argument, NULL, OPTION_FAST_FORWARD},
+        {"skip-to-wave", required_argument, NULL, OPTION_SKIP_TO_WAVE},
+        {"load-snapshot", required_argument, NULL, OPTION_LOAD_SNAPSHOT},
+        {"save-snapshot", required_argument, NULL, OPTION_SAVE_SNAPSHOT},
+        {"halfblock", no_argument, NULL, OPTION_HALF_BLOCK},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:f:r:R:p:Hn:s:P:T:h", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            if (!parse_int(optarg, MIN_RATE, MAX_RATE, &options->tick_rate))
+            {
+                fprintf(stderr, "Invalid tick rate: %s\n", optarg);
+                return false;
+            }
+            break;
+        case 'f':
+            if (!parse_int(optarg, MIN_RATE, MAX_RATE, &options->render_rate))
+            {
+                fprintf(stderr, "Invalid frame rate: %s\n", optarg);
+                return false;
+            }
+            break;
+        case 'r':
+            if (!parse_seed(optarg, &options->seed))
+            {
+                fprintf(stderr, "Invalid seed: %s\n", optarg);
+                return false;
+            }
+            break;
+        case 'R':
+            options->record_path = optarg;
+            break;
+        case 'p':
+            options->replay_path = optarg;
+            break;
+        case 'H':
+            options->headless = true;
+            break;
+        case 'n':
+            if (!parse_long(optarg, 1, LONG_MAX, &options->ticks))
+            {
+                fprintf(stderr, "Invalid tick count: %s\n", optarg);
+                return false;
+            }
+            break;
+        case 's':
+            if (!parse_size(optarg, &options->width, &options->height))
+            {
+                fprintf(stderr, "Invalid screen size: %s\n", optarg);
+                return false;
+            }
+            break;
+        case 'P':
+            options->profile_path = optarg;
+            break;
+        case 'T':
+            options->trace_path = optarg;
+            break;
+        case OPTION_MAX_ENEMIES:
+        case OPTION_MAX_BULLETS:
+        case OPTION_MAX_POWERUPS:
+        case OPTION_MAX_STARS:
+            if (!parse_capacity(opt, optarg, &options->capacities))
+            {
+                fprintf(stderr, "Invalid entity capacity: %s\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_TIME_SCALE:
+            if (!parse_float(optarg, MIN_TIME_SCALE, MAX_TIME_SCALE, &options->time_scale))
+            {
+                fprintf(stderr, "Invalid time scale: %s\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_FAST_FORWARD:
+            if (!parse_long(optarg, 0, LONG_MAX, &options->fast_forward_ticks))
+            {
+                fprintf(stderr, "Invalid tick count: %s\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_SKIP_TO_WAVE:
+            if (!parse_int(optarg, 0, INT_MAX, &options->skip_to_wave))
+            {
+                fprintf(stderr, "Invalid wave: %s\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_LOAD_SNAPSHOT:
+            options->load_snapshot_path = optarg;
+            break;
+        case OPTION_SAVE_SNAPSHOT:
+            options->save_snapshot_path = optarg;
+            break;
+        case OPTION_HALF_BLOCK:
+            options->half_block = true;
+            break;
+        case 'h':
+            options->show_help = true;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void options_print_usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  -t, --tick-rate N   Simulation ticks per second (default %d)\n", DEFAULT_TICK_RATE);
+    fprintf(stderr, "  -f, --fps N         Frames drawn per second (default %d)\n", DEFAULT_RENDER_RATE);
+    fprintf(stderr, "  -r, --seed N        Seed for the game's random number generator (default: clock)\n");
+    fprintf(stderr, "  -R, --record FILE   Record per-tick input to FILE\n");
+    fprintf(stderr, "  -p, --replay FILE   Play back input recorded with --record\n");
+    fprintf(stderr, "  -H, --headless      Run the simulation with scripted input and no terminal I/O\n");
+    fprintf(stderr, "  -n, --ticks N       Ticks to simulate in headless mode (default %ld)\n", DEFAULT_HEADLESS_TICKS);
+    fprintf(stderr, "  -s, --size WxH      Playfield size in headless mode (default %dx%d)\n", DEFAULT_HEADLESS_WIDTH,
+            DEFAULT_HEADLESS_HEIGHT);
+    fprintf(stderr, "  -P, --profile FILE  Write per-phase frame timings to FILE on exit\n");
+    fprintf(stderr, "  -T, --trace FILE    Write a Chrome trace-event JSON timeline to FILE\n");
+    fprintf(stderr, "  --time-scale X      Run the simulation X times real time, %g to %g (default 1)\n",
+            MIN_TIME_SCALE, MAX_TIME_SCALE);
+    fprintf(stderr, "  --fast-forward N    Run the first N ticks as fast as possible, drawing a few frames\n");
+    fprintf(stderr, "  --skip-to-wave W    Fast-forward until wave W starts\n");
+    fprintf(stderr, "  --load-snapshot FILE  Start from a world saved with --save-snapshot\n");
+    fprintf(stderr, "  --save-snapshot FILE  Save the world to FILE on exit\n");
+    fprintf(stderr, "  --halfblock         Draw bullets and stars at half-cell height (needs a UTF-8 terminal)\n");
+    fprintf(stderr, "  --max-enemies N     Enemies in a formation (default %d)\n", DEFAULT_MAX_ENEMIES);
+    fprintf(stderr, "  --max-bullets N     Bullets in flight at once (default %d)\n", DEFAULT_MAX_BULLETS);
+    fprintf(stderr, "  --max-powerups N    Power-ups on screen at once (default %d)\n", DEFAULT_MAX_POWERUPS);
+    fprintf(stderr, "  --max-stars N       Background stars (default %d)\n", DEFAULT_MAX_STARS);
+    fprintf(stderr, "  -h, --help          Show this help\n");
+}
@@ -0,0 +1,50 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "entities.h"
+
+#define DEFAULT_TICK_RATE 30
+#define DEFAULT_RENDER_RATE 30
+#define DEFAULT_HEADLESS_TICKS 1000000L
+#define DEFAULT_HEADLESS_WIDTH 80
+#define DEFAULT_HEADLESS_HEIGHT 24
+#define MIN_TIME_SCALE 0.25f
+#define MAX_TIME_SCALE 16.0f
+#define MIN_RATE 1
+#define MAX_RATE 1000
+#define MAX_SCREEN_SIZE 1000
+
+typedef struct
+{
+    int tick_rate;   /* Simulation ticks per second */
+    int render_rate; /* Frames drawn per second */
+    bool show_help;
+    uint64_t seed; /* Game RNG seed, taken from the clock unless given */
+    const char *record_path; /* Write per-tick input here */
+    const char *replay_path; /* Take input from this recording instead */
+    EntityCapacities capacities;
+    const char *profile_path;       /* Write phase timings here on exit */
+    const char *trace_path;         /* Write trace events here while running */
+    float time_scale;               /* Simulated seconds per wall-clock second */
+    long fast_forward_ticks;        /* Run this many ticks unthrottled before playing normally */
+    int skip_to_wave;               /* Also keep going unthrottled until this wave starts */
+    const char *load_snapshot_path; /* Start from this saved world instead of the menu */
+    const char *save_snapshot_path; /* Save the world here on exit */
+    bool half_block;                /* Draw bullets and stars as half-cell pixels */
+
+    /* Headless simulation */
+    bool headless;
+    long ticks;
+    int width;
+    int height;
+} GameOptions;
+
+void options_init(GameOptions *options);
+bool options_parse(GameOptions *options, int argc, char **argv);
+void options_print_usage(const char *program);
+bool options_rate_valid(int rate);
+bool options_size_valid(int width, int height);
+
+#endif
@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "output_thread.h"
+#include "trace.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The waiting slot index, plus a tag set by the game and cleared when the writer takes the frame */
+#define SLOT_INDEX_MASK 0x3u
+#define SLOT_FRESH 0x4u
+
+/* Slots the game and the writer start with; the third starts out waiting, holding nothing new */
+#define INITIAL_DRAWING_SLOT 0
+#define INITIAL_WRITING_SLOT 1
+#define INITIAL_WAITING_SLOT 2
+
+/* Sent to the writer at shutdown to break it out of a write blocked on a stalled terminal */
+#define OUTPUT_WAKE_SIGNAL SIGUSR1
+#define OUTPUT_WAKE_INTERVAL_NS 10000000L
+
+/* Does nothing; being delivered is what makes the blocked write return with EINTR */
+static void output_wake_handler(int sig)
+{
+    (void)sig;
+}
+
+static void *output_thread_run(void *arg)
+{
+    OutputThread *output = arg;
+    unsigned writing = INITIAL_WRITING_SLOT;
+    trace_thread("output");
+
+    for (;;)
+    {
+        while (sem_wait(&output->frame_ready) != 0)
+            ;
+        if (atomic_load(&output->stopping))
+            break;
+
+        /* Only the game tags the waiting slot, so once seen it stays tagged until we take it */
+        if (!(atomic_load(&output->waiting) & SLOT_FRESH))
+            continue;
+
+        writing = atomic_exchange(&output->waiting, writing) & SLOT_INDEX_MASK;
+        output->writer->buffer = output->slots[writing];
+
+        uint64_t start = trace_now();
+        terminal_buffer_flush(output->writer);
+        trace_span("write", start, trace_now());
+    }
+
+    atomic_store(&output->finished, true);
+    return NULL;
+}
+
+/* Start writing frames drawn into buffer, which can be cells only; the writer keeps all encoding state */
+OutputThread *output_thread_create(TerminalBuffer *buffer)
+{
+    OutputThread *output = calloc(1, sizeof(OutputThread));
+    if (!output)
+        return NULL;
+
+    output->writer = terminal_buffer_create(buffer->width, buffer->height);
+    TerminalCell *spare = calloc((size_t)buffer->width * buffer->height, sizeof(TerminalCell));
+    if (!output->writer || !spare || sem_init(&output->frame_ready, 0, 0) != 0)
+    {
+        free(spare);
+        terminal_buffer_destroy(output->writer);
+        free(output);
+        return NULL;
+    }
+
+    /* Only send cells that changed since the last frame written */
+    terminal_buffer_set_damage_tracking(output->writer, true);
+
+    output->slots[INITIAL_DRAWING_SLOT] = buffer->buffer;
+    output->slots[INITIAL_WRITING_SLOT] = output->writer->buffer;
+    output->slots[INITIAL_WAITING_SLOT] = spare;
+    output->drawing = INITIAL_DRAWING_SLOT;
+    atomic_init(&output->waiting, INITIAL_WAITING_SLOT);
+    atomic_init(&output->stopping, false);
+    atomic_init(&output->finished, false);
+
+    /* No SA_RESTART, so the signal interrupts a write instead of resuming it */
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = output_wake_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(OUTPUT_WAKE_SIGNAL, &action, NULL);
+
+    if (pthread_create(&output->thread, NULL, output_thread_run, output) != 0)
+    {
+        sem_destroy(&output->frame_ready);
+        free(spare);
+        terminal_buffer_destroy(output->writer);
+        free(output);
+        return NULL;
+    }
+    return output;
+}
+
+/*
+ * Stop the thread, leaving any frame still waiting unwritten and cutting
+ * short one being written, so a stalled terminal cannot hang shutdown. The
+ * game's buffer keeps whichever cell array it is drawing into, so it is
+ * destroyed as usual afterwards.
+ */
+void output_thread_destroy(OutputThread *output)
+{
+    if (!output)
+        return;
+
+    atomic_store(&output->stopping, true);
+    atomic_store(&output->writer->write_cancelled, true);
+    sem_post(&output->frame_ready);
+
+    /* The signal can land just before the writer blocks in write, so keep sending it until the thread is out */
+    struct timespec interval = {0, OUTPUT_WAKE_INTERVAL_NS};
+    while (!atomic_load(&output->finished))
+    {
+        pthread_kill(output->thread, OUTPUT_WAKE_SIGNAL);
+        nanosleep(&interval, NULL);
+    }
+    pthread_join(output->thread, NULL);
+    sem_destroy(&output->frame_ready);
+
+    free(output->slots[atomic_load(&output->waiting) & SLOT_INDEX_MASK]);
+    terminal_buffer_destroy(output->writer);
+    free(output);
+}
+
+/*
+ * Hand the frame drawn into buffer to the writer and give buffer the cell
+ * array of an older frame to draw the next one into; clear it first.
+ */
+void output_thread_submit(OutputThread *output, TerminalBuffer *buffer)
+{
+    unsigned previous = atomic_exchange(&output->waiting, (unsigned)output->drawing | SLOT_FRESH);
+    output->drawing = (int)(previous & SLOT_INDEX_MASK);
+    buffer->buffer = output->slots[output->drawing];
+
+    /* The writer was already woken for the frame this one replaces */
+    if (previous & SLOT_FRESH)
+    {
+        output->frames_dropped++;
+        trace_instant("frame dropped", "dropped", output->frames_dropped);
+        return;
+    }
+    sem_post(&output->frame_ready);
+}
@@ -0,0 +1,41 @@
+#ifndef OUTPUT_THREAD_H
+#define OUTPUT_THREAD_H
+
+#include "terminal.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/* Cell arrays in flight: one being drawn, one waiting, one being written */
+#define OUTPUT_SLOT_COUNT 3
+
+/*
+ * Encodes and writes frames on a thread of its own, so a slow link stalls
+ * only that thread and never the simulation. Frames are handed over
+ * through a triple buffer: the game draws into one cell array while the
+ * writer sends another, and the third holds the newest finished frame.
+ * Submitting swaps the drawn array with the waiting one in a single atomic
+ * exchange, so neither side ever blocks the other. If the writer has not
+ * picked up the waiting frame by then, that frame is dropped in favour of
+ * the new one; the writer diffs against what it last sent, so a dropped
+ * frame costs nothing but its own cells.
+ */
+typedef struct
+{
+    TerminalCell *slots[OUTPUT_SLOT_COUNT];
+    atomic_uint waiting;    /* Slot holding the newest submitted frame, tagged when not yet taken */
+    int drawing;            /* Slot the game draws into; only the game thread touches it */
+    TerminalBuffer *writer; /* Encoder state for the frames the thread writes */
+    sem_t frame_ready;
+    atomic_bool stopping;
+    atomic_bool finished; /* Set by the thread as it exits */
+    pthread_t thread;
+    long frames_dropped; /* Counted by the game thread */
+} OutputThread;
+
+OutputThread *output_thread_create(TerminalBuffer *buffer);
+void output_thread_destroy(OutputThread *output);
+void output_thread_submit(OutputThread *output, TerminalBuffer *buffer);
+
+#endif
@@ -0,0 +1,140 @@
+#include "profiler.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NANOSECONDS_PER_MICROSECOND 1000.0
+#define PERCENTILE 0.99
+
+static const char *phase_names[PROFILE_PHASE_COUNT] = {
+    "input", "player", "enemy ai", "bullets", "collision", "render", "flush",
+};
+
+Profiler *profiler_create(void)
+{
+    Profiler *profiler = calloc(1, sizeof(Profiler));
+    if (profiler)
+        profiler->frame_start = trace_now();
+    return profiler;
+}
+
+void profiler_destroy(Profiler *profiler)
+{
+    free(profiler);
+}
+
+void profiler_begin(Profiler *profiler, ProfilePhase phase)
+{
+    if (!profiler)
+        return;
+
+    profiler->phases[phase].start = trace_now();
+}
+
+void profiler_end(Profiler *profiler, ProfilePhase phase)
+{
+    if (!profiler)
+        return;
+
+    PhaseTimer *timer = &profiler->phases[phase];
+    uint64_t end = trace_now();
+    timer->pending += end - timer->start;
+    timer->ran = true;
+
+    trace_span(phase_names[phase], timer->start, end);
+}
+
+/* Move this frame's phase times into the rolling windows */
+void profiler_end_frame(Profiler *profiler)
+{
+    if (!profiler)
+        return;
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        PhaseTimer *timer = &profiler->phases[p];
+        if (!timer->ran)
+            continue;
+
+        timer->samples[timer->next_sample] = timer->pending;
+        timer->next_sample = (timer->next_sample + 1) % PROFILER_WINDOW;
+        if (timer->sample_count < PROFILER_WINDOW)
+            timer->sample_count++;
+
+        timer->frames++;
+        timer->total += timer->pending;
+        if (timer->pending > timer->max)
+            timer->max = timer->pending;
+
+        timer->pending = 0;
+        timer->ran = false;
+    }
+
+    uint64_t end = trace_now();
+    trace_span("frame", profiler->frame_start, end);
+    profiler->frame_start = end;
+}
+
+static int compare_samples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Min, average and 99th percentile over the rolling window; false if the phase has not run yet */
+bool profiler_stats(const Profiler *profiler, ProfilePhase phase, ProfileStats *stats)
+{
+    const PhaseTimer *timer = &profiler->phases[phase];
+    int count = timer->sample_count;
+    if (count == 0)
+        return false;
+
+    uint64_t sorted[PROFILER_WINDOW];
+    memcpy(sorted, timer->samples, count * sizeof(uint64_t));
+    qsort(sorted, count, sizeof(uint64_t), compare_samples);
+
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += sorted[i];
+
+    int p99_index = (int)(count * PERCENTILE);
+    if (p99_index >= count)
+        p99_index = count - 1;
+
+    stats->min_us = sorted[0] / NANOSECONDS_PER_MICROSECOND;
+    stats->avg_us = (double)sum / count / NANOSECONDS_PER_MICROSECOND;
+    stats->p99_us = sorted[p99_index] / NANOSECONDS_PER_MICROSECOND;
+    return true;
+}
+
+const char *profiler_phase_name(ProfilePhase phase)
+{
+    return phase_names[phase];
+}
+
+/* Write whole-run and rolling statistics for every phase as a text table */
+bool profiler_dump(const Profiler *profiler, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    fprintf(file, "# times in microseconds; min/avg/p99 over the last %d frames each phase ran in\n", PROFILER_WINDOW);
+    fprintf(file, "%-10s %10s %10s %10s %10s %10s %10s\n", "phase", "frames", "run avg", "run max", "min", "avg",
+            "p99");
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        const PhaseTimer *timer = &profiler->phases[p];
+        ProfileStats stats = {0};
+        profiler_stats(profiler, (ProfilePhase)p, &stats);
+
+        double run_avg = timer->frames > 0 ? (double)timer->total / timer->frames / NANOSECONDS_PER_MICROSECOND : 0.0;
+        fprintf(file, "%-10s %10ld %10.1f %10.1f %10.1f %10.1f %10.1f\n", phase_names[p], timer->frames, run_avg,
+                timer->max / NANOSECONDS_PER_MICROSECOND, stats.min_us, stats.avg_us, stats.p99_us);
+    }
+
+    return fclose(file) == 0;
+}
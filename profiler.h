@@ -0,0 +1,64 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Frames kept per phase for the rolling statistics */
+#define PROFILER_WINDOW 256
+
+typedef enum
+{
+    PROFILE_INPUT,
+    PROFILE_PLAYER,
+    PROFILE_ENEMY_AI,
+    PROFILE_BULLETS,
+    PROFILE_COLLISION,
+    PROFILE_RENDER,
+    PROFILE_FLUSH,
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+typedef struct
+{
+    uint64_t samples[PROFILER_WINDOW]; /* Nanoseconds spent per frame, ring buffer */
+    int sample_count;
+    int next_sample;
+    uint64_t start;   /* Clock reading at profiler_begin */
+    uint64_t pending; /* Time accumulated in the current frame */
+    bool ran;         /* Whether the phase ran in the current frame */
+    long frames;      /* Frames the phase ran in, over the whole run */
+    uint64_t total;
+    uint64_t max;
+} PhaseTimer;
+
+/*
+ * Wall-clock time per phase of the main loop. A phase may run several times
+ * per frame (one simulation tick each); its time is summed over the frame,
+ * and frames where it did not run are left out of its statistics. While a
+ * trace is open every begin/end pair and every frame is also written to it.
+ */
+typedef struct
+{
+    PhaseTimer phases[PROFILE_PHASE_COUNT];
+    uint64_t frame_start; /* Clock reading at the end of the previous frame */
+    bool overlay_visible;
+} Profiler;
+
+typedef struct
+{
+    double min_us;
+    double avg_us;
+    double p99_us;
+} ProfileStats;
+
+Profiler *profiler_create(void);
+void profiler_destroy(Profiler *profiler);
+void profiler_begin(Profiler *profiler, ProfilePhase phase);
+void profiler_end(Profiler *profiler, ProfilePhase phase);
+void profiler_end_frame(Profiler *profiler);
+bool profiler_stats(const Profiler *profiler, ProfilePhase phase, ProfileStats *stats);
+const char *profiler_phase_name(ProfilePhase phase);
+bool profiler_dump(const Profiler *profiler, const char *path);
+
+#endif
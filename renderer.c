@@ -1,8 +1,25 @@
 #include "renderer.h"
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
-void renderer_draw_player(TerminalBuffer *buf, Player *player)
+/* Profiler overlay panel, in cells from the top right corner */
+#define PROFILER_PANEL_WIDTH 34
+#define PROFILER_PANEL_Y 2
+
+/* Position between the previous and current tick, alpha in [0, 1] */
+static int interpolate(float prev, float current, float alpha)
+{
+    return (int)(prev + (current - prev) * alpha);
+}
+
+/* Interpolated y as a half-block pixel row */
+static int interpolate_pixel_row(float prev, float current, float alpha)
+{
+    return (int)floorf((prev + (current - prev) * alpha) * TERM_PIXELS_PER_CELL);
+}
+
+void renderer_draw_player(TerminalBuffer *buf, Player *player, float alpha)
 {
     if (player->captured)
         return;
@@ -14,11 +31,11 @@ void renderer_draw_player(TerminalBuffer *buf, Player *player)
             return; /* Don't draw on odd frames to create flashing */
     }
 
-    int x = (int)player->x;
-    int y = (int)player->y;
+    int x = interpolate(player->prev_x, player->x, alpha);
+    int y = interpolate(player->prev_y, player->y, alpha);
 
     /* Determine color based on player state */
-    uint8_t color = COLOR_CYAN;
+    TerminalColor color = COLOR_CYAN;
     if (player->god_mode)
         color = COLOR_RED;
     else if (player->has_reflect_shield)
@@ -52,17 +69,14 @@ void renderer_draw_player(TerminalBuffer *buf, Player *player)
     }
 }
 
-void renderer_draw_enemy(TerminalBuffer *buf, Enemy *enemy)
+static void renderer_draw_enemy(TerminalBuffer *buf, EnemyPool *enemies, int index, float alpha)
 {
-    if (!enemy->active)
-    {
-        return;
-    }
+    EnemyInfo *enemy = &enemies->info[index];
 
-    int x = (int)enemy->x;
-    int y = (int)enemy->y;
+    int x = interpolate(enemies->prev_x[index], enemies->x[index], alpha);
+    int y = interpolate(enemies->prev_y[index], enemies->y[index], alpha);
 
-    uint8_t color = COLOR_WHITE;
+    TerminalColor color = COLOR_WHITE;
     char sprite[4] = "???";
 
     switch (enemy->type)
@@ -107,20 +121,28 @@ void renderer_draw_enemy(TerminalBuffer *buf, Enemy *enemy)
     terminal_buffer_set_char(buf, x + 1, y, sprite[2], color);
 }
 
-void renderer_draw_bullet(TerminalBuffer *buf, Bullet *bullet)
+void renderer_draw_enemies(TerminalBuffer *buf, EnemyPool *enemies, float alpha)
 {
-    if (!bullet->active)
+    for (int i = enemy_next(enemies, 0); i < enemies->capacity; i = enemy_next(enemies, i + 1))
     {
-        return;
+        renderer_draw_enemy(buf, enemies, i, alpha);
     }
+}
+
+static void renderer_draw_bullet(TerminalBuffer *buf, BulletPool *bullets, int index, float alpha)
+{
+    BulletInfo *bullet = &bullets->info[index];
 
-    int x = (int)bullet->x;
-    int y = (int)bullet->y;
+    int x = interpolate(bullets->prev_x[index], bullets->x[index], alpha);
+    int y = interpolate(bullets->prev_y[index], bullets->y[index], alpha);
+
+    char ch = '*';
+    TerminalColor color = COLOR_WHITE;
 
     if (bullet->is_player_bullet)
     {
-        char ch = '|';
-        uint8_t color = COLOR_YELLOW;
+        ch = '|';
+        color = COLOR_YELLOW;
 
         switch (bullet->type)
         {
@@ -139,12 +161,26 @@ void renderer_draw_bullet(TerminalBuffer *buf, Bullet *bullet)
         default:
             break;
         }
+    }
 
-        terminal_buffer_set_char(buf, x, y, ch, color);
+    /* A two-pixel streak for player shots and a single pixel for enemy fire, moving in half-cell steps */
+    if (buf->half_block)
+    {
+        int pixel_y = interpolate_pixel_row(bullets->prev_y[index], bullets->y[index], alpha);
+        terminal_buffer_set_pixel(buf, x, pixel_y, color);
+        if (bullet->is_player_bullet)
+            terminal_buffer_set_pixel(buf, x, pixel_y + 1, color);
+        return;
     }
-    else
+
+    terminal_buffer_set_char(buf, x, y, ch, color);
+}
+
+void renderer_draw_bullets(TerminalBuffer *buf, BulletPool *bullets, float alpha)
+{
+    for (int d = 0; d < bullets->count; d++)
     {
-        terminal_buffer_set_char(buf, x, y, '*', COLOR_WHITE);
+        renderer_draw_bullet(buf, bullets, bullets->dense[d], alpha);
     }
 }
 
@@ -159,7 +195,7 @@ void renderer_draw_powerup(TerminalBuffer *buf, PowerUp *powerup)
     int y = (int)powerup->y;
 
     char icon;
-    uint8_t color;
+    TerminalColor color;
 
     switch (powerup->type)
     {
@@ -214,9 +250,24 @@ void renderer_draw_powerup(TerminalBuffer *buf, PowerUp *powerup)
 
 void renderer_draw_stars(TerminalBuffer *buf, Star stars[], int count)
 {
+    if (buf->half_block)
+    {
+        /* Alternate which half of its cell each star lights, so the field does not line up on the cell grid */
+        for (int i = 0; i < count; i++)
+        {
+            int pixel_y = stars[i].y * TERM_PIXELS_PER_CELL + ((stars[i].x + stars[i].y) & 1);
+            terminal_buffer_set_pixel(buf, stars[i].x, pixel_y, stars[i].character == '*' ? COLOR_WHITE : COLOR_GRAY);
+        }
+        return;
+    }
+
+    /* Faint stars are dimmed so the bright ones stand out */
     for (int i = 0; i < count; i++)
     {
-        terminal_buffer_set_char(buf, stars[i].x, stars[i].y, stars[i].character, COLOR_GRAY);
+        uint32_t attributes = stars[i].character == '*' ? 0 : TERM_ATTR_DIM;
+        terminal_buffer_set_cell(buf, stars[i].x, stars[i].y,
+                                 (TerminalCell){(unsigned char)stars[i].character, COLOR_GRAY, TERM_COLOR_DEFAULT,
+                                                attributes});
     }
 }
 
@@ -240,16 +291,19 @@ void renderer_draw_hud(TerminalBuffer *buf, Player *player, GameState *state)
         terminal_buffer_set_string(buf, 30, 0, text, COLOR_WHITE);
     }
 
-    /* Special weapon charge bar */
+    /* Special weapon charge bar, shading from blue to cyan as it fills */
     int bar_x = 50;
     terminal_buffer_set_string(buf, bar_x, 0, "SPECIAL[", COLOR_GRAY);
     int charge_bars = (int)(player->special_charge / 10.0f);
     for (int i = 0; i < 10; i++)
     {
-        if (i < charge_bars)
-            terminal_buffer_set_char(buf, bar_x + 8 + i, 0, '=', player->special_ready ? COLOR_GREEN : COLOR_CYAN);
-        else
+        if (i >= charge_bars)
             terminal_buffer_set_char(buf, bar_x + 8 + i, 0, '-', COLOR_GRAY);
+        else if (player->special_ready)
+            terminal_buffer_set_cell(buf, bar_x + 8 + i, 0, (TerminalCell){'=', COLOR_GREEN, TERM_COLOR_DEFAULT,
+                                                                           TERM_ATTR_BOLD});
+        else
+            terminal_buffer_set_char(buf, bar_x + 8 + i, 0, '=', TERM_RGB(0, 64 + i * 19, 255));
     }
     terminal_buffer_set_char(buf, bar_x + 18, 0, ']', COLOR_GRAY);
 
@@ -331,7 +385,7 @@ void renderer_draw_game_over(TerminalBuffer *buf, GameState *state, int screen_w
 
     const char *game_over = "GAME OVER";
     int len = strlen(game_over);
-    terminal_buffer_set_string(buf, (screen_width - len) / 2, center_y, game_over, COLOR_RED);
+    terminal_buffer_set_styled_string(buf, (screen_width - len) / 2, center_y, game_over, COLOR_RED, TERM_ATTR_BOLD);
 
     snprintf(text, sizeof(text), "FINAL SCORE: %d", state->score);
     len = strlen(text);
@@ -349,7 +403,7 @@ void renderer_draw_wave_transition(TerminalBuffer *buf, GameState *state, int sc
 
     snprintf(text, sizeof(text), "WAVE %d", state->current_wave);
     int len = strlen(text);
-    terminal_buffer_set_string(buf, (screen_width - len) / 2, center_y, text, COLOR_CYAN);
+    terminal_buffer_set_styled_string(buf, (screen_width - len) / 2, center_y, text, COLOR_CYAN, TERM_ATTR_BOLD);
 
     const char *ready = "GET READY!";
     len = strlen(ready);
@@ -362,7 +416,7 @@ void renderer_draw_menu(TerminalBuffer *buf, int screen_width, int screen_height
 
     const char *title = "G A L A G A";
     int len = strlen(title);
-    terminal_buffer_set_string(buf, (screen_width - len) / 2, center_y, title, COLOR_RED);
+    terminal_buffer_set_styled_string(buf, (screen_width - len) / 2, center_y, title, COLOR_RED, TERM_ATTR_BOLD);
 
     const char *controls1 = "CONTROLS:";
     len = strlen(controls1);
@@ -402,3 +456,48 @@ void renderer_draw_bonus_stage_hud(TerminalBuffer *buf, BonusStage *bonus, GameS
     snprintf(text, sizeof(text), "SCORE: %d", state->score);
     terminal_buffer_set_string(buf, (buf->width - 20) / 2, 1, text, COLOR_WHITE);
 }
+
+/* Phase timing table in the top right corner, over a blank panel so it stays readable */
+void renderer_draw_profiler(TerminalBuffer *buf, const Profiler *profiler)
+{
+    char text[64];
+    int x = buf->width - PROFILER_PANEL_WIDTH - 1;
+
+    for (int row = 0; row < PROFILE_PHASE_COUNT + 1; row++)
+    {
+        for (int col = 0; col < PROFILER_PANEL_WIDTH; col++)
+            terminal_buffer_set_char(buf, x + col, PROFILER_PANEL_Y + row, ' ', COLOR_WHITE);
+    }
+
+    snprintf(text, sizeof(text), "%-10s %7s %7s %7s", "PHASE us", "MIN", "AVG", "P99");
+    terminal_buffer_set_string(buf, x, PROFILER_PANEL_Y, text, COLOR_YELLOW);
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        ProfileStats stats;
+        if (profiler_stats(profiler, (ProfilePhase)p, &stats))
+            snprintf(text, sizeof(text), "%-10s %7.1f %7.1f %7.1f", profiler_phase_name((ProfilePhase)p), stats.min_us,
+                     stats.avg_us, stats.p99_us);
+        else
+            snprintf(text, sizeof(text), "%-10s %7s %7s %7s", profiler_phase_name((ProfilePhase)p), "-", "-", "-");
+        terminal_buffer_set_string(buf, x, PROFILER_PANEL_Y + 1 + p, text, COLOR_WHITE);
+    }
+}
+
+/* Bottom left, only while the simulation is not running at real time */
+void renderer_draw_time_scale(TerminalBuffer *buf, float time_scale, bool fast_forwarding)
+{
+    char text[32];
+    int y = buf->height - 2;
+
+    if (fast_forwarding)
+    {
+        terminal_buffer_set_string(buf, 2, y, ">> FAST FORWARD", COLOR_YELLOW);
+        return;
+    }
+    if (time_scale == 1.0f)
+        return;
+
+    snprintf(text, sizeof(text), "TIME x%g", time_scale);
+    terminal_buffer_set_string(buf, 2, y, text, time_scale > 1.0f ? COLOR_YELLOW : COLOR_CYAN);
+}
@@ -0,0 +1,272 @@
+#include "replay.h"
+#include <stdlib.h>
+#include <string.h>
+#include "options.h"
+
+/*
+ * File layout (little-endian):
+ *   "GLRP", u16 version, u16 tick rate, u16 width, u16 height, u64 seed,
+ *   u32 enemy, bullet, power-up and star capacities (version 2 and later)
+ *   then runs of identical input, each a LEB128 input mask followed by a
+ *   LEB128 tick count, so a steady key state costs a few bytes.
+ */
+#define REPLAY_MAGIC "GLRP"
+#define REPLAY_VERSION 2
+#define REPLAY_HEADER_SIZE 36
+#define REPLAY_HEADER_SIZE_V1 20
+
+enum
+{
+    REPLAY_BIT_UP = 1 << 0,
+    REPLAY_BIT_DOWN = 1 << 1,
+    REPLAY_BIT_LEFT = 1 << 2,
+    REPLAY_BIT_RIGHT = 1 << 3,
+    REPLAY_BIT_SHOOT = 1 << 4,
+    REPLAY_BIT_QUIT = 1 << 5,
+    REPLAY_BIT_GOD_TOGGLE = 1 << 6,
+    REPLAY_BIT_BOMB = 1 << 7,
+    REPLAY_BIT_SPECIAL = 1 << 8
+};
+
+static uint16_t input_to_mask(const InputState *input)
+{
+    uint16_t mask = 0;
+    if (input->up)
+        mask |= REPLAY_BIT_UP;
+    if (input->down)
+        mask |= REPLAY_BIT_DOWN;
+    if (input->left)
+        mask |= REPLAY_BIT_LEFT;
+    if (input->right)
+        mask |= REPLAY_BIT_RIGHT;
+    if (input->shoot)
+        mask |= REPLAY_BIT_SHOOT;
+    if (input->quit)
+        mask |= REPLAY_BIT_QUIT;
+    if (input->god_toggle)
+        mask |= REPLAY_BIT_GOD_TOGGLE;
+    if (input->bomb)
+        mask |= REPLAY_BIT_BOMB;
+    if (input->special)
+        mask |= REPLAY_BIT_SPECIAL;
+    return mask;
+}
+
+static void mask_to_input(uint16_t mask, InputState *input)
+{
+    input->up = (mask & REPLAY_BIT_UP) != 0;
+    input->down = (mask & REPLAY_BIT_DOWN) != 0;
+    input->left = (mask & REPLAY_BIT_LEFT) != 0;
+    input->right = (mask & REPLAY_BIT_RIGHT) != 0;
+    input->shoot = (mask & REPLAY_BIT_SHOOT) != 0;
+    input->quit = (mask & REPLAY_BIT_QUIT) != 0;
+    input->god_toggle = (mask & REPLAY_BIT_GOD_TOGGLE) != 0;
+    input->bomb = (mask & REPLAY_BIT_BOMB) != 0;
+    input->special = (mask & REPLAY_BIT_SPECIAL) != 0;
+}
+
+static void put_u16(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xff;
+    out[1] = value >> 8;
+}
+
+static uint16_t get_u16(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static void put_u32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static void write_varint(FILE *file, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)((value & 0x7f) | 0x80), file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool read_varint(FILE *file, uint32_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        int byte = fgetc(file);
+        if (byte == EOF)
+            return false;
+
+        *value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+Replay *replay_create(const char *path, const ReplayHeader *header)
+{
+    Replay *replay = malloc(sizeof(Replay));
+    if (!replay)
+        return NULL;
+
+    replay->file = fopen(path, "wb");
+    if (!replay->file)
+    {
+        free(replay);
+        return NULL;
+    }
+
+    replay->writing = true;
+    replay->header = *header;
+    replay->mask = 0;
+    replay->run = 0;
+    replay->ticks = 0;
+
+    uint8_t bytes[REPLAY_HEADER_SIZE];
+    memcpy(bytes, REPLAY_MAGIC, 4);
+    put_u16(bytes + 4, REPLAY_VERSION);
+    put_u16(bytes + 6, (uint16_t)header->tick_rate);
+    put_u16(bytes + 8, (uint16_t)header->width);
+    put_u16(bytes + 10, (uint16_t)header->height);
+    for (int i = 0; i < 8; i++)
+        bytes[12 + i] = (uint8_t)(header->seed >> (8 * i));
+    put_u32(bytes + 20, (uint32_t)header->capacities.enemies);
+    put_u32(bytes + 24, (uint32_t)header->capacities.bullets);
+    put_u32(bytes + 28, (uint32_t)header->capacities.powerups);
+    put_u32(bytes + 32, (uint32_t)header->capacities.stars);
+
+    fwrite(bytes, 1, sizeof(bytes), replay->file);
+    return replay;
+}
+
+Replay *replay_open(const char *path)
+{
+    Replay *replay = malloc(sizeof(Replay));
+    if (!replay)
+        return NULL;
+
+    replay->file = fopen(path, "rb");
+    if (!replay->file)
+    {
+        free(replay);
+        return NULL;
+    }
+
+    /* Version 1 recordings predate configurable capacities and ran with the defaults */
+    uint8_t bytes[REPLAY_HEADER_SIZE];
+    bool valid = fread(bytes, 1, REPLAY_HEADER_SIZE_V1, replay->file) == REPLAY_HEADER_SIZE_V1 &&
+                 memcmp(bytes, REPLAY_MAGIC, 4) == 0;
+    uint16_t version = valid ? get_u16(bytes + 4) : 0;
+    if (version == REPLAY_VERSION)
+        valid = fread(bytes + REPLAY_HEADER_SIZE_V1, 1, REPLAY_HEADER_SIZE - REPLAY_HEADER_SIZE_V1, replay->file) ==
+                REPLAY_HEADER_SIZE - REPLAY_HEADER_SIZE_V1;
+    else if (version != 1)
+        valid = false;
+
+    if (!valid)
+    {
+        fclose(replay->file);
+        free(replay);
+        return NULL;
+    }
+
+    replay->writing = false;
+    replay->header.tick_rate = get_u16(bytes + 6);
+    replay->header.width = get_u16(bytes + 8);
+    replay->header.height = get_u16(bytes + 10);
+    replay->header.seed = 0;
+    for (int i = 0; i < 8; i++)
+        replay->header.seed |= (uint64_t)bytes[12 + i] << (8 * i);
+
+    entity_capacities_default(&replay->header.capacities);
+    if (version == REPLAY_VERSION)
+    {
+        replay->header.capacities.enemies = (int)get_u32(bytes + 20);
+        replay->header.capacities.bullets = (int)get_u32(bytes + 24);
+        replay->header.capacities.powerups = (int)get_u32(bytes + 28);
+        replay->header.capacities.stars = (int)get_u32(bytes + 32);
+    }
+
+    /* Held to the same bounds as the command line, since the header replaces those options */
+    if (!entity_capacities_valid(&replay->header.capacities) || !options_rate_valid(replay->header.tick_rate) ||
+        !options_size_valid(replay->header.width, replay->header.height))
+    {
+        fclose(replay->file);
+        free(replay);
+        return NULL;
+    }
+    replay->mask = 0;
+    replay->run = 0;
+    replay->ticks = 0;
+
+    return replay;
+}
+
+static void replay_flush_run(Replay *replay)
+{
+    if (replay->run == 0)
+        return;
+
+    write_varint(replay->file, replay->mask);
+    write_varint(replay->file, replay->run);
+    replay->run = 0;
+}
+
+/* Record the input used for one tick */
+void replay_record(Replay *replay, const InputState *input)
+{
+    if (!replay || !replay->writing)
+        return;
+
+    uint16_t mask = input_to_mask(input);
+    if (mask != replay->mask || replay->run == UINT32_MAX)
+    {
+        replay_flush_run(replay);
+        replay->mask = mask;
+    }
+
+    replay->run++;
+    replay->ticks++;
+}
+
+/* Fill in the input for the next tick; false once the recording is exhausted */
+bool replay_next(Replay *replay, InputState *input)
+{
+    if (!replay || replay->writing)
+        return false;
+
+    if (replay->run == 0)
+    {
+        uint32_t mask;
+        if (!read_varint(replay->file, &mask) || !read_varint(replay->file, &replay->run) || replay->run == 0)
+            return false;
+        replay->mask = (uint16_t)mask;
+    }
+
+    mask_to_input(replay->mask, input);
+    replay->run--;
+    replay->ticks++;
+    return true;
+}
+
+void replay_close(Replay *replay)
+{
+    if (!replay)
+        return;
+
+    if (replay->writing)
+        replay_flush_run(replay);
+
+    fclose(replay->file);
+    free(replay);
+}
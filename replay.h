@@ -0,0 +1,36 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "input.h"
+#include "entities.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Everything besides input that a replay needs to reproduce a run */
+typedef struct
+{
+    uint64_t seed;
+    int tick_rate;
+    int width;
+    int height;
+    EntityCapacities capacities;
+} ReplayHeader;
+
+typedef struct
+{
+    FILE *file;
+    bool writing;
+    ReplayHeader header;
+    uint16_t mask; /* Input bits of the current run */
+    uint32_t run;  /* Ticks recorded so far, or left to play, in the current run */
+    long ticks;    /* Ticks recorded or played back */
+} Replay;
+
+Replay *replay_create(const char *path, const ReplayHeader *header);
+Replay *replay_open(const char *path);
+void replay_record(Replay *replay, const InputState *input);
+bool replay_next(Replay *replay, InputState *input);
+void replay_close(Replay *replay);
+
+#endif
@@ -0,0 +1,33 @@
+#include "rng.h"
+
+#define PCG_MULTIPLIER 6364136223846793005ULL
+#define PCG_DEFAULT_STREAM 1442695040888963407ULL
+
+void rng_seed(Rng *rng, uint64_t seed)
+{
+    rng->state = 0;
+    rng->increment = PCG_DEFAULT_STREAM | 1u;
+    rng_next(rng);
+    rng->state += seed;
+    rng_next(rng);
+}
+
+uint32_t rng_next(Rng *rng)
+{
+    uint64_t old_state = rng->state;
+    rng->state = old_state * PCG_MULTIPLIER + rng->increment;
+
+    /* XSH RR output function */
+    uint32_t xorshifted = (uint32_t)(((old_state >> 18u) ^ old_state) >> 27u);
+    uint32_t rotation = (uint32_t)(old_state >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((-rotation) & 31u));
+}
+
+/* Uniform integer in [0, bound) */
+int rng_range(Rng *rng, int bound)
+{
+    if (bound <= 0)
+        return 0;
+
+    return (int)(((uint64_t)rng_next(rng) * (uint32_t)bound) >> 32);
+}
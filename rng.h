@@ -0,0 +1,17 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* PCG32 generator state, one per game so runs are reproducible from a seed */
+typedef struct
+{
+    uint64_t state;
+    uint64_t increment;
+} Rng;
+
+void rng_seed(Rng *rng, uint64_t seed);
+uint32_t rng_next(Rng *rng);
+int rng_range(Rng *rng, int bound);
+
+#endif
@@ -0,0 +1,245 @@
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "options.h"
+
+/*
+ * File layout: "GSNP", u16 version, u16 width, u16 height, u16 reserved,
+ * u32 enemy, bullet, power-up and star capacities, u32 state size,
+ * u64 arena size (all little-endian), then the raw state and arena image.
+ */
+#define SNAPSHOT_MAGIC "GSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 40
+
+/* Everything in a Game outside its arena that changes while playing */
+typedef struct
+{
+    bool started;
+    Rng rng;
+    Player player;
+    GameState game_state;
+
+    int formation_active_count;
+    float formation_offset_x;
+    float formation_direction;
+    float dive_spawn_timer;
+    float capture_beam_timer;
+    int difficulty_level;
+
+    float bonus_timer;
+    int bonus_enemies_destroyed;
+    bool bonus_active;
+    float bonus_spawn_timer;
+    int bonus_enemies_spawned;
+
+    int bullet_count;
+    int bullet_free_head;
+} SnapshotState;
+
+static void put_u16(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xff;
+    out[1] = value >> 8;
+}
+
+static uint16_t get_u16(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static void put_u32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static void put_u64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint64_t get_u64(const uint8_t *in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= (uint64_t)in[i] << (8 * i);
+    return value;
+}
+
+static Snapshot *snapshot_allocate(const SnapshotHeader *header)
+{
+    if (header->arena_size > SIZE_MAX - header->state_size)
+        return NULL;
+
+    Snapshot *snapshot = malloc(sizeof(Snapshot));
+    if (!snapshot)
+        return NULL;
+
+    snapshot->header = *header;
+    snapshot->size = header->state_size + (size_t)header->arena_size;
+    snapshot->data = malloc(snapshot->size);
+    if (!snapshot->data)
+    {
+        free(snapshot);
+        return NULL;
+    }
+    return snapshot;
+}
+
+/* An empty snapshot sized for the given game */
+Snapshot *snapshot_create(const Game *game)
+{
+    SnapshotHeader header = {game->screen_width, game->screen_height, game->capacities, sizeof(SnapshotState),
+                             game->arena.used};
+    return snapshot_allocate(&header);
+}
+
+void snapshot_destroy(Snapshot *snapshot)
+{
+    if (!snapshot)
+        return;
+
+    free(snapshot->data);
+    free(snapshot);
+}
+
+/* Copy the game into a snapshot made for it by snapshot_create */
+void snapshot_capture(Snapshot *snapshot, const Game *game)
+{
+    SnapshotState state;
+    memset(&state, 0, sizeof(state));
+
+    state.started = game->started;
+    state.rng = game->rng;
+    state.player = game->player;
+    state.game_state = game->game_state;
+
+    state.formation_active_count = game->formation.active_count;
+    state.formation_offset_x = game->formation.formation_offset_x;
+    state.formation_direction = game->formation.formation_direction;
+    state.dive_spawn_timer = game->formation.dive_spawn_timer;
+    state.capture_beam_timer = game->formation.capture_beam_timer;
+    state.difficulty_level = game->formation.difficulty_level;
+
+    state.bonus_timer = game->bonus_stage.timer;
+    state.bonus_enemies_destroyed = game->bonus_stage.enemies_destroyed;
+    state.bonus_active = game->bonus_stage.active;
+    state.bonus_spawn_timer = game->bonus_stage.spawn_timer;
+    state.bonus_enemies_spawned = game->bonus_stage.enemies_spawned;
+
+    state.bullet_count = game->bullets.count;
+    state.bullet_free_head = game->bullets.free_head;
+
+    memcpy(snapshot->data, &state, sizeof(state));
+    memcpy(snapshot->data + sizeof(state), game->arena.base, game->arena.used);
+}
+
+/* Put the game back in the captured state; false, leaving it untouched, if the snapshot was made for another layout */
+bool snapshot_restore(const Snapshot *snapshot, Game *game)
+{
+    const SnapshotHeader *header = &snapshot->header;
+    if (header->width != game->screen_width || header->height != game->screen_height ||
+        memcmp(&header->capacities, &game->capacities, sizeof(EntityCapacities)) != 0 ||
+        header->state_size != sizeof(SnapshotState) || header->arena_size != game->arena.used)
+        return false;
+
+    SnapshotState state;
+    memcpy(&state, snapshot->data, sizeof(state));
+
+    game->started = state.started;
+    game->rng = state.rng;
+    game->player = state.player;
+    game->game_state = state.game_state;
+
+    game->formation.active_count = state.formation_active_count;
+    game->formation.formation_offset_x = state.formation_offset_x;
+    game->formation.formation_direction = state.formation_direction;
+    game->formation.dive_spawn_timer = state.dive_spawn_timer;
+    game->formation.capture_beam_timer = state.capture_beam_timer;
+    game->formation.difficulty_level = state.difficulty_level;
+
+    game->bonus_stage.timer = state.bonus_timer;
+    game->bonus_stage.enemies_destroyed = state.bonus_enemies_destroyed;
+    game->bonus_stage.active = state.bonus_active;
+    game->bonus_stage.spawn_timer = state.bonus_spawn_timer;
+    game->bonus_stage.enemies_spawned = state.bonus_enemies_spawned;
+
+    game->bullets.count = state.bullet_count;
+    game->bullets.free_head = state.bullet_free_head;
+
+    memcpy(game->arena.base, snapshot->data + sizeof(state), game->arena.used);
+    return true;
+}
+
+bool snapshot_write(const Snapshot *snapshot, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    const SnapshotHeader *header = &snapshot->header;
+    uint8_t bytes[SNAPSHOT_HEADER_SIZE];
+    memcpy(bytes, SNAPSHOT_MAGIC, 4);
+    put_u16(bytes + 4, SNAPSHOT_VERSION);
+    put_u16(bytes + 6, (uint16_t)header->width);
+    put_u16(bytes + 8, (uint16_t)header->height);
+    put_u16(bytes + 10, 0);
+    put_u32(bytes + 12, (uint32_t)header->capacities.enemies);
+    put_u32(bytes + 16, (uint32_t)header->capacities.bullets);
+    put_u32(bytes + 20, (uint32_t)header->capacities.powerups);
+    put_u32(bytes + 24, (uint32_t)header->capacities.stars);
+    put_u32(bytes + 28, header->state_size);
+    put_u64(bytes + 32, header->arena_size);
+
+    bool ok = fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes) &&
+              fwrite(snapshot->data, 1, snapshot->size, file) == snapshot->size;
+    return fclose(file) == 0 && ok;
+}
+
+Snapshot *snapshot_read(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    uint8_t bytes[SNAPSHOT_HEADER_SIZE];
+    if (fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes) || memcmp(bytes, SNAPSHOT_MAGIC, 4) != 0 ||
+        get_u16(bytes + 4) != SNAPSHOT_VERSION)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    SnapshotHeader header;
+    header.width = get_u16(bytes + 6);
+    header.height = get_u16(bytes + 8);
+    header.capacities.enemies = (int)get_u32(bytes + 12);
+    header.capacities.bullets = (int)get_u32(bytes + 16);
+    header.capacities.powerups = (int)get_u32(bytes + 20);
+    header.capacities.stars = (int)get_u32(bytes + 24);
+    header.state_size = get_u32(bytes + 28);
+    header.arena_size = get_u64(bytes + 32);
+
+    /* A snapshot from another build's struct layouts, or with a playfield options refuse, cannot be trusted */
+    Snapshot *snapshot = NULL;
+    if (header.state_size == sizeof(SnapshotState) && entity_capacities_valid(&header.capacities) &&
+        options_size_valid(header.width, header.height))
+        snapshot = snapshot_allocate(&header);
+
+    if (snapshot && fread(snapshot->data, 1, snapshot->size, file) != snapshot->size)
+    {
+        snapshot_destroy(snapshot);
+        snapshot = NULL;
+    }
+
+    fclose(file);
+    return snapshot;
+}
@@ -0,0 +1,41 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "game.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* What a snapshot must match to be restored into a game */
+typedef struct
+{
+    int width;
+    int height;
+    EntityCapacities capacities;
+    uint32_t state_size; /* Bytes of non-arena state, which change with the build's struct layouts */
+    uint64_t arena_size;
+} SnapshotHeader;
+
+/*
+ * The whole world at one tick: the game's scalar state followed by an image
+ * of its arena, which holds every entity array. Capturing and restoring are
+ * two memcpys into a buffer allocated up front, so a running game can take
+ * one at any time. The blob is raw memory, so snapshot files are only
+ * portable between builds with the same struct layouts; the header checks
+ * that before anything is restored.
+ */
+typedef struct
+{
+    SnapshotHeader header;
+    size_t size; /* Bytes in data */
+    unsigned char *data;
+} Snapshot;
+
+Snapshot *snapshot_create(const Game *game);
+void snapshot_destroy(Snapshot *snapshot);
+void snapshot_capture(Snapshot *snapshot, const Game *game);
+bool snapshot_restore(const Snapshot *snapshot, Game *game);
+bool snapshot_write(const Snapshot *snapshot, const char *path);
+Snapshot *snapshot_read(const char *path);
+
+#endif
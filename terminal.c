@@ -6,11 +6,503 @@
 #include <termios.h>
 #include <sys/ioctl.h>
 #include <signal.h>
+#include <errno.h>
+#include <poll.h>
 
-#define OUTPUT_BUFFER_SIZE (80 * 40 * 20)
+/* Pre-formatted escape sequences so the flush loop never calls sprintf */
+#define ESCAPE_TABLE_SIZE 512
+#define ESCAPE_MAX_LENGTH 15
+
+typedef struct
+{
+    uint8_t length;
+    char bytes[ESCAPE_MAX_LENGTH];
+} Escape;
+
+static Escape color_escapes[256];                /* Whole sequence for a lone foreground change: "\033[31m" */
+static Escape color_params[256];                 /* Shortest SGR form: "31", "91" or "38;5;<color>" */
+static Escape background_params[256];            /* "41", "101" or "48;5;<color>" */
+static Escape row_escapes[ESCAPE_TABLE_SIZE];    /* "\033[<row>;" */
+static Escape column_escapes[ESCAPE_TABLE_SIZE]; /* "<column>H" */
+static bool escape_tables_ready = false;
+
+/* Palette colors with the short SGR forms 30-37 and 90-97 */
+#define PALETTE_BASIC_COLORS 8
+#define PALETTE_BRIGHT_COLORS 16
+
+/* The SGR state of the terminal, which flushes track to send only what changes */
+typedef struct
+{
+    TerminalColor fg;
+    TerminalColor bg;
+    uint32_t attributes;
+} Style;
+
+/* Where every flush starts and ends: terminal_init and the end of each flush reset to it */
+static const Style style_default = {TERM_COLOR_DEFAULT, TERM_COLOR_DEFAULT, 0};
+
+/* Longest SGR sequence, "\033[22;1;2;38;2;255;255;255;48;2;255;255;255m", plus slack for table copies */
+#define SGR_MAX_LENGTH 44
+#define SGR_SCRATCH_SIZE (SGR_MAX_LENGTH + ESCAPE_MAX_LENGTH)
+
+/* Worst-case encoded size of a single cell: a style change plus a 4-byte UTF-8 character */
+#define UTF8_MAX_LENGTH 4
+#define CELL_OUTPUT_MAX (SGR_MAX_LENGTH + UTF8_MAX_LENGTH)
+#define RESET_SEQUENCE "\033[m"
+#define RESET_SEQUENCE_LENGTH 3
 
 static struct termios orig_termios;
 static bool terminal_initialized = false;
+static bool repeat_supported = false;       /* Found by terminal_init */
+static bool synchronized_supported = false; /* Found by terminal_init */
+
+/* Set when a flush stopped partway through its frame, possibly inside an escape sequence */
+static atomic_bool frame_cut_short = false;
+
+/* How long terminal_init waits for the terminal to answer a query */
+#define QUERY_TIMEOUT_MS 200
+#define QUERY_REPLY_SIZE 64
+
+/* How often a flush waiting on a full non-blocking tty checks whether it was cancelled */
+#define WRITE_POLL_TIMEOUT_MS 50
+
+/* DEC mode 2026: the terminal holds off repainting between these, so a frame split by the pty never shows half drawn */
+#define SYNC_BEGIN "\033[?2026h"
+#define SYNC_END "\033[?2026l"
+#define SYNC_LENGTH 8
+
+static void escape_set(Escape *escape, const char *fmt, int value)
+{
+    escape->length = (uint8_t)snprintf(escape->bytes, sizeof(escape->bytes), fmt, value);
+}
+
+static void escape_tables_init(void)
+{
+    if (escape_tables_ready)
+        return;
+
+    for (int i = 0; i < 256; i++)
+    {
+        if (i < PALETTE_BASIC_COLORS)
+        {
+            escape_set(&color_params[i], "%d", 30 + i);
+            escape_set(&background_params[i], "%d", 40 + i);
+        }
+        else if (i < PALETTE_BRIGHT_COLORS)
+        {
+            escape_set(&color_params[i], "%d", 90 + i - PALETTE_BASIC_COLORS);
+            escape_set(&background_params[i], "%d", 100 + i - PALETTE_BASIC_COLORS);
+        }
+        else
+        {
+            escape_set(&color_params[i], "38;5;%d", i);
+            escape_set(&background_params[i], "48;5;%d", i);
+        }
+
+        Escape *escape = &color_escapes[i];
+        escape->length = (uint8_t)snprintf(escape->bytes, sizeof(escape->bytes), "\033[%sm", color_params[i].bytes);
+    }
+
+    for (int i = 0; i < ESCAPE_TABLE_SIZE; i++)
+    {
+        escape_set(&row_escapes[i], "\033[%d;", i + 1);
+        escape_set(&column_escapes[i], "%dH", i + 1);
+    }
+
+    escape_tables_ready = true;
+}
+
+static int append_bytes(char *out, const char *bytes, int length)
+{
+    memcpy(out, bytes, length);
+    return length;
+}
+
+static int append_escape(char *out, const Escape *escape)
+{
+    memcpy(out, escape->bytes, ESCAPE_MAX_LENGTH);
+    return escape->length;
+}
+
+static int append_number(char *out, int value)
+{
+    char digits[12];
+    int count = 0;
+
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (int i = 0; i < count; i++)
+        out[i] = digits[count - 1 - i];
+
+    return count;
+}
+
+static int number_length(int value)
+{
+    int length = 1;
+    while (value >= 10)
+    {
+        value /= 10;
+        length++;
+    }
+    return length;
+}
+
+/* Append a code point as UTF-8 */
+static int append_utf8(char *out, uint32_t ch)
+{
+    if (ch < 0x80)
+    {
+        out[0] = (char)ch;
+        return 1;
+    }
+    if (ch < 0x800)
+    {
+        out[0] = (char)(0xc0 | (ch >> 6));
+        out[1] = (char)(0x80 | (ch & 0x3f));
+        return 2;
+    }
+    if (ch < 0x10000)
+    {
+        out[0] = (char)(0xe0 | (ch >> 12));
+        out[1] = (char)(0x80 | ((ch >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (ch & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (ch >> 18));
+    out[1] = (char)(0x80 | ((ch >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((ch >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (ch & 0x3f));
+    return 4;
+}
+
+static int utf8_length(uint32_t ch)
+{
+    return ch < 0x80 ? 1 : ch < 0x800 ? 2 : ch < 0x10000 ? 3 : 4;
+}
+
+/* Terminals advertise 24-bit color support through COLORTERM */
+static bool truecolor_supported(void)
+{
+    const char *colorterm = getenv("COLORTERM");
+    return colorterm && (strcmp(colorterm, "truecolor") == 0 || strcmp(colorterm, "24bit") == 0);
+}
+
+static int color_distance(int r1, int g1, int b1, int r2, int g2, int b2)
+{
+    return (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2);
+}
+
+/* Level of the 6x6x6 color cube nearest a channel value */
+static int cube_level(int value)
+{
+    return value < 48 ? 0 : value < 115 ? 1 : (value - 35) / 40;
+}
+
+/* Nearest xterm palette entry to an RGB color, from the color cube or the gray ramp */
+static int palette_from_rgb(TerminalColor color)
+{
+    static const int cube_values[6] = {0, 95, 135, 175, 215, 255};
+
+    int r = (color >> 16) & 0xff;
+    int g = (color >> 8) & 0xff;
+    int b = color & 0xff;
+
+    int cr = cube_level(r);
+    int cg = cube_level(g);
+    int cb = cube_level(b);
+    int cube_distance = color_distance(r, g, b, cube_values[cr], cube_values[cg], cube_values[cb]);
+
+    /* Gray ramp 232-255 runs from 8 to 238 in steps of 10 */
+    int average = (r + g + b) / 3;
+    int gray = average < 8 ? 0 : average > 238 ? 23 : (average - 3) / 10;
+    int gray_value = 8 + gray * 10;
+    int gray_distance = color_distance(r, g, b, gray_value, gray_value, gray_value);
+
+    if (gray_distance < cube_distance)
+        return 232 + gray;
+    return 16 + 36 * cr + 6 * cg + cb;
+}
+
+/* Append the SGR parameters selecting a color, followed by a separator */
+static int append_color_params(char *out, TerminalColor color, bool background, bool truecolor)
+{
+    int pos;
+
+    if (color == TERM_COLOR_DEFAULT)
+    {
+        pos = append_bytes(out, background ? "49" : "39", 2);
+    }
+    else
+    {
+        if (!(color & TERM_COLOR_PALETTE) && !truecolor)
+            color = TERM_PALETTE(palette_from_rgb(color));
+
+        if (color & TERM_COLOR_PALETTE)
+        {
+            pos = append_escape(out, background ? &background_params[color & 0xff] : &color_params[color & 0xff]);
+        }
+        else
+        {
+            pos = append_bytes(out, background ? "48;2;" : "38;2;", 5);
+            pos += append_number(out + pos, (color >> 16) & 0xff);
+            out[pos++] = ';';
+            pos += append_number(out + pos, (color >> 8) & 0xff);
+            out[pos++] = ';';
+            pos += append_number(out + pos, color & 0xff);
+        }
+    }
+
+    out[pos++] = ';';
+    return pos;
+}
+
+static int append_attribute_params(char *out, uint32_t attributes)
+{
+    int pos = 0;
+    if (attributes & TERM_ATTR_BOLD)
+        pos += append_bytes(out + pos, "1;", 2);
+    if (attributes & TERM_ATTR_DIM)
+        pos += append_bytes(out + pos, "2;", 2);
+    return pos;
+}
+
+/*
+ * Append the SGR sequence taking the terminal from the current style to the
+ * target: either just the parameters that differ, or a reset followed by
+ * every parameter the target needs, whichever is shorter. The reset can only
+ * win when something returns to its default, so it is not tried otherwise.
+ */
+static int append_style(char *out, Style *current, const Style *target, bool truecolor)
+{
+    int pos = append_bytes(out, "\033[", 2);
+    bool to_default = false;
+
+    uint32_t added = target->attributes & ~current->attributes;
+    if (current->attributes & ~target->attributes)
+    {
+        /* Normal intensity clears both bold and dim */
+        pos += append_bytes(out + pos, "22;", 3);
+        added = target->attributes;
+        to_default = true;
+    }
+    pos += append_attribute_params(out + pos, added);
+    if (target->fg != current->fg)
+    {
+        pos += append_color_params(out + pos, target->fg, false, truecolor);
+        to_default |= target->fg == TERM_COLOR_DEFAULT;
+    }
+    if (target->bg != current->bg)
+    {
+        pos += append_color_params(out + pos, target->bg, true, truecolor);
+        to_default |= target->bg == TERM_COLOR_DEFAULT;
+    }
+
+    if (to_default)
+    {
+        char reset[SGR_SCRATCH_SIZE];
+        int reset_length = append_bytes(reset, "0;", 2);
+        reset_length += append_attribute_params(reset + reset_length, target->attributes);
+        if (target->fg != TERM_COLOR_DEFAULT)
+            reset_length += append_color_params(reset + reset_length, target->fg, false, truecolor);
+        if (target->bg != TERM_COLOR_DEFAULT)
+            reset_length += append_color_params(reset + reset_length, target->bg, true, truecolor);
+
+        /* A bare reset needs no parameter at all: "\033[m" */
+        if (reset_length == 2)
+            reset_length = 1;
+
+        if (2 + reset_length < pos)
+            pos = 2 + append_bytes(out + 2, reset, reset_length);
+    }
+
+    /* Replace the trailing separator */
+    out[pos - 1] = 'm';
+
+    *current = *target;
+    return pos;
+}
+
+/* Whether the terminal's current style already draws the cell; a space shows nothing but its background */
+static inline bool style_matches(const Style *current, const TerminalCell *cell)
+{
+    if (cell->bg != current->bg)
+        return false;
+    return cell->ch == ' ' || (cell->fg == current->fg && cell->attributes == current->attributes);
+}
+
+/* Append one cell, changing style only where it shows; ASCII, the common case, skips the encoder */
+static inline int append_cell(char *out, const TerminalCell *cell, Style *current, bool truecolor)
+{
+    int pos = 0;
+    if (!style_matches(current, cell))
+    {
+        Style target = {cell->fg, cell->bg, cell->attributes};
+        if (cell->ch == ' ')
+        {
+            target.fg = current->fg;
+            target.attributes = current->attributes;
+        }
+
+        /* Most changes are a palette foreground alone, which has a ready-made sequence */
+        if (target.bg == current->bg && target.attributes == current->attributes && (target.fg & TERM_COLOR_PALETTE))
+        {
+            pos += append_escape(out, &color_escapes[target.fg & 0xff]);
+            current->fg = target.fg;
+        }
+        else
+        {
+            pos += append_style(out, current, &target, truecolor);
+        }
+    }
+
+    if (cell->ch < 0x80)
+    {
+        out[pos] = (char)cell->ch;
+        return pos + 1;
+    }
+    return pos + append_utf8(out + pos, cell->ch);
+}
+
+/* Append a cursor position escape for a 0-based cell */
+static int append_cursor_move(char *out, int x, int y)
+{
+    int pos = 0;
+
+    if (y < ESCAPE_TABLE_SIZE)
+    {
+        pos += append_escape(out, &row_escapes[y]);
+    }
+    else
+    {
+        pos += append_bytes(out, "\033[", 2);
+        pos += append_number(out + pos, y + 1);
+        out[pos++] = ';';
+    }
+
+    if (x < ESCAPE_TABLE_SIZE)
+    {
+        pos += append_escape(out + pos, &column_escapes[x]);
+    }
+    else
+    {
+        pos += append_number(out + pos, x + 1);
+        out[pos++] = 'H';
+    }
+
+    return pos;
+}
+
+/* Length of the cursor position escape for a 0-based cell */
+static int cursor_move_length(int x, int y)
+{
+    return 4 + number_length(y + 1) + number_length(x + 1);
+}
+
+/* "\033[<n>C", with the count left out for a single column */
+#define CURSOR_FORWARD_LENGTH 3
+
+/* "\033[K" */
+#define ERASE_LINE_LENGTH 3
+
+/* "\033[<n>b" */
+#define REPEAT_LENGTH 3
+
+/*
+ * Upper bound on the bytes a single flush can emit. In the worst damaged
+ * frame every other cell changes, so each cell may need its own cursor move.
+ * Escapes are copied at their fixed table width, hence the trailing slack.
+ */
+static size_t output_bound(int width, int height)
+{
+    size_t per_cell = CELL_OUTPUT_MAX + cursor_move_length(width, height);
+    return (size_t)width * height * per_cell + RESET_SEQUENCE_LENGTH + 2 * SYNC_LENGTH + ESCAPE_MAX_LENGTH;
+}
+
+/*
+ * Write the whole frame, retrying on partial writes and a non-blocking tty,
+ * unless write_cancelled is set; the canceller interrupts a blocked write
+ * with a signal, and the bounded poll notices it on a non-blocking one.
+ */
+static void write_all(TerminalBuffer *buf, const char *data, size_t length)
+{
+    while (length > 0 && !atomic_load(&buf->write_cancelled))
+    {
+        ssize_t written = write(STDOUT_FILENO, data, length);
+        if (written > 0)
+        {
+            data += written;
+            length -= written;
+        }
+        else if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            struct pollfd pfd = {.fd = STDOUT_FILENO, .events = POLLOUT};
+            poll(&pfd, 1, WRITE_POLL_TIMEOUT_MS);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (length > 0)
+        atomic_store(&frame_cut_short, true);
+}
+
+/* Read a reply to a query up to its final character; false if the terminal stays silent */
+static bool read_reply(char *reply, size_t size, char final)
+{
+    size_t length = 0;
+    struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+
+    while (length < size - 1 && poll(&pfd, 1, QUERY_TIMEOUT_MS) > 0)
+    {
+        if (read(STDIN_FILENO, &reply[length], 1) != 1)
+            break;
+        if (reply[length++] == final)
+        {
+            reply[length] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Ask which optional features the terminal has, in one round trip. DECRQM
+ * reports whether mode 2026 is known (1 or 2 when it can be switched, 3 when
+ * always set); terminals that do not recognise the query stay silent. For
+ * REP, draw a space, repeat it once, and ask where the cursor ended up. The
+ * cursor report always comes back and comes last, so it ends the reply.
+ */
+static void probe_features(void)
+{
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+        return;
+
+    printf("\033[?2026$p\033[H \033[1b\033[6n");
+    fflush(stdout);
+
+    char reply[QUERY_REPLY_SIZE];
+    if (!read_reply(reply, sizeof(reply), 'R'))
+        return;
+
+    int mode_state, row, column;
+    const char *mode = strstr(reply, "\033[?2026;");
+    synchronized_supported = mode && sscanf(mode, "\033[?2026;%d$y", &mode_state) == 1 && mode_state >= 1 &&
+                             mode_state <= 3;
+
+    const char *cursor = strrchr(reply, '\033');
+    repeat_supported = cursor && sscanf(cursor, "\033[%d;%dR", &row, &column) == 2 && column == 3;
+}
 
 void terminal_init(void)
 {
@@ -37,8 +529,13 @@ void terminal_init(void)
     /* Disable line wrapping to prevent auto-scroll */
     printf("\033[?7l");
 
-    /* Clear screen and hide cursor */
-    printf("\033[2J\033[H\033[?25l");
+    probe_features();
+
+    /* Drop whatever else came in meanwhile; a reply arriving later still is skipped by the input parser */
+    tcflush(STDIN_FILENO, TCIFLUSH);
+
+    /* Reset attributes, which flushes assume, then clear screen and hide cursor */
+    printf("\033[0m\033[2J\033[H\033[?25l");
     fflush(stdout);
 
     terminal_initialized = true;
@@ -49,6 +546,19 @@ void terminal_cleanup(void)
     if (!terminal_initialized)
         return;
 
+    /*
+     * A frame cut short may have stopped inside an escape sequence, and
+     * inside a synchronized update; CAN aborts the sequence so the restore
+     * below is not parsed as part of it, then the update is ended.
+     */
+    if (atomic_load(&frame_cut_short))
+    {
+        printf("\030");
+        if (synchronized_supported)
+            printf(SYNC_END);
+        atomic_store(&frame_cut_short, false);
+    }
+
     /* Re-enable line wrapping */
     printf("\033[?7h");
 
@@ -88,8 +598,11 @@ bool terminal_validate_size(void)
     return (width >= TERM_MIN_WIDTH && height >= TERM_MIN_HEIGHT);
 }
 
-TerminalBuffer *terminal_buffer_create(int width, int height)
+/* Encoding buffers get a front copy for damage tracking and room for a worst-case frame */
+static TerminalBuffer *terminal_buffer_allocate(int width, int height, bool encoder)
 {
+    escape_tables_init();
+
     TerminalBuffer *buf = malloc(sizeof(TerminalBuffer));
     if (!buf)
     {
@@ -99,10 +612,24 @@ TerminalBuffer *terminal_buffer_create(int width, int height)
     buf->width = width;
     buf->height = height;
     buf->cursor_visible = false;
-    buf->buffer = calloc(width * height * 2, sizeof(char));
+    buf->flushed_bytes = 0;
+    buf->damage_tracking = false;
+    buf->front_valid = false;
+    buf->half_block = false;
+    buf->truecolor = truecolor_supported();
+    buf->use_repeat = repeat_supported;
+    buf->synchronized_output = synchronized_supported;
+    atomic_init(&buf->write_cancelled, false);
+    buf->buffer = calloc(width * height, sizeof(TerminalCell));
+    buf->front = encoder ? calloc(width * height, sizeof(TerminalCell)) : NULL;
+    buf->output_capacity = encoder ? output_bound(width, height) : 0;
+    buf->output = encoder ? malloc(buf->output_capacity) : NULL;
 
-    if (!buf->buffer)
+    if (!buf->buffer || (encoder && (!buf->front || !buf->output)))
     {
+        free(buf->buffer);
+        free(buf->front);
+        free(buf->output);
         free(buf);
         return NULL;
     }
@@ -111,11 +638,24 @@ TerminalBuffer *terminal_buffer_create(int width, int height)
     return buf;
 }
 
+TerminalBuffer *terminal_buffer_create(int width, int height)
+{
+    return terminal_buffer_allocate(width, height, true);
+}
+
+/* A buffer that is only drawn into and whose cells are sent by another, so it cannot be flushed */
+TerminalBuffer *terminal_buffer_create_cells(int width, int height)
+{
+    return terminal_buffer_allocate(width, height, false);
+}
+
 void terminal_buffer_destroy(TerminalBuffer *buf)
 {
     if (buf)
     {
         free(buf->buffer);
+        free(buf->front);
+        free(buf->output);
         free(buf);
     }
 }
@@ -126,26 +666,33 @@ void terminal_buffer_clear(TerminalBuffer *buf)
         return;
 
     /* Clear buffer properly: set chars to space and colors to default */
+    TerminalCell blank = {' ', TERM_COLOR_DEFAULT, TERM_COLOR_DEFAULT, 0};
     int total_cells = buf->width * buf->height;
     for (int i = 0; i < total_cells; i++)
-    {
-        buf->buffer[i * 2] = ' ';             /* Character */
-        buf->buffer[i * 2 + 1] = COLOR_BLACK; /* Color */
-    }
+        buf->buffer[i] = blank;
 }
 
-void terminal_buffer_set_char(TerminalBuffer *buf, int x, int y, char ch, uint8_t color)
+void terminal_buffer_set_cell(TerminalBuffer *buf, int x, int y, TerminalCell cell)
 {
     /* Silently ignore out-of-bounds writes */
     if (!buf || x < 0 || x >= buf->width || y < 0 || y >= buf->height)
         return;
 
-    int index = (y * buf->width + x) * 2;
-    buf->buffer[index] = ch;
-    buf->buffer[index + 1] = color;
+    buf->buffer[y * buf->width + x] = cell;
 }
 
-void terminal_buffer_set_string(TerminalBuffer *buf, int x, int y, const char *str, uint8_t color)
+void terminal_buffer_set_char(TerminalBuffer *buf, int x, int y, char ch, TerminalColor color)
+{
+    terminal_buffer_set_cell(buf, x, y, (TerminalCell){(unsigned char)ch, color, TERM_COLOR_DEFAULT, 0});
+}
+
+void terminal_buffer_set_string(TerminalBuffer *buf, int x, int y, const char *str, TerminalColor color)
+{
+    terminal_buffer_set_styled_string(buf, x, y, str, color, 0);
+}
+
+void terminal_buffer_set_styled_string(TerminalBuffer *buf, int x, int y, const char *str, TerminalColor color,
+                                       uint32_t attributes)
 {
     if (!buf || !str)
     {
@@ -155,60 +702,297 @@ void terminal_buffer_set_string(TerminalBuffer *buf, int x, int y, const char *s
     int i = 0;
     while (str[i] != '\0' && (x + i) < buf->width)
     {
-        terminal_buffer_set_char(buf, x + i, y, str[i], color);
+        terminal_buffer_set_cell(buf, x + i, y,
+                                 (TerminalCell){(unsigned char)str[i], color, TERM_COLOR_DEFAULT, attributes});
         i++;
     }
 }
 
-void terminal_buffer_flush(TerminalBuffer *buf)
+/*
+ * Light one half of a cell, pixel_y counting TERM_PIXELS_PER_CELL rows per
+ * cell. A lit top half is drawn as an upper half block in the foreground
+ * color with the bottom half as background, and so on; a pixel drawn over
+ * a character replaces it.
+ */
+void terminal_buffer_set_pixel(TerminalBuffer *buf, int x, int pixel_y, TerminalColor color)
 {
-    if (!buf || !buf->buffer)
+    if (!buf || x < 0 || x >= buf->width || pixel_y < 0 || pixel_y >= buf->height * TERM_PIXELS_PER_CELL)
         return;
 
-    /* Use single write buffer to reduce flickering */
-    static char output_buffer[OUTPUT_BUFFER_SIZE];
-    int pos = 0;
+    /* An unlit half shows the default background */
+    TerminalCell *cell = &buf->buffer[(pixel_y / TERM_PIXELS_PER_CELL) * buf->width + x];
+    TerminalColor top = TERM_COLOR_DEFAULT;
+    TerminalColor bottom = TERM_COLOR_DEFAULT;
+    if (cell->ch == GLYPH_UPPER_HALF)
+    {
+        top = cell->fg;
+        bottom = cell->bg;
+    }
+    else if (cell->ch == GLYPH_LOWER_HALF)
+    {
+        top = cell->bg;
+        bottom = cell->fg;
+    }
+    else if (cell->ch == GLYPH_FULL_BLOCK)
+    {
+        top = cell->fg;
+        bottom = cell->fg;
+    }
+
+    if (pixel_y % TERM_PIXELS_PER_CELL == 0)
+        top = color;
+    else
+        bottom = color;
+
+    cell->attributes = 0;
+    if (top == TERM_COLOR_DEFAULT && bottom == TERM_COLOR_DEFAULT)
+    {
+        cell->ch = ' ';
+        cell->fg = TERM_COLOR_DEFAULT;
+        cell->bg = TERM_COLOR_DEFAULT;
+    }
+    else if (top == bottom)
+    {
+        cell->ch = GLYPH_FULL_BLOCK;
+        cell->fg = color;
+        cell->bg = TERM_COLOR_DEFAULT;
+    }
+    else if (top == TERM_COLOR_DEFAULT)
+    {
+        cell->ch = GLYPH_LOWER_HALF;
+        cell->fg = bottom;
+        cell->bg = TERM_COLOR_DEFAULT;
+    }
+    else
+    {
+        cell->ch = GLYPH_UPPER_HALF;
+        cell->fg = top;
+        cell->bg = bottom;
+    }
+}
+
+static bool cell_changed(TerminalBuffer *buf, int index)
+{
+    return memcmp(&buf->buffer[index], &buf->front[index], sizeof(TerminalCell)) != 0;
+}
+
+/* A cell that erasing leaves exactly as drawn */
+static bool cell_blank(const TerminalCell *cell)
+{
+    return cell->ch == ' ' && cell->bg == TERM_COLOR_DEFAULT;
+}
+
+/*
+ * Move the cursor from (*cursor_x, *cursor_y) to (x, y) the cheapest way:
+ * rewriting the cells in between when they already have the current style,
+ * CUF along the row, CR LF to the start of the next row, or an absolute CUP.
+ * The cursor coordinates are -1 when unknown.
+ */
+static int append_cursor_to(char *out, TerminalBuffer *buf, const Style *style, int cursor_x, int cursor_y, int x,
+                            int y)
+{
+    if (cursor_x == x && cursor_y == y)
+        return 0;
 
-    /* Start from top-left */
-    pos += sprintf(output_buffer + pos, "\033[1;1H");
+    int move_length = cursor_move_length(x, y);
+
+    if (cursor_y == y && cursor_x >= 0 && cursor_x < x)
+    {
+        const TerminalCell *row = &buf->buffer[y * buf->width];
+        int gap_bytes = 0;
+        for (int gx = cursor_x; gx < x && gap_bytes <= move_length; gx++)
+        {
+            if (!style_matches(style, &row[gx]))
+            {
+                gap_bytes = move_length + 1;
+                break;
+            }
+            gap_bytes += utf8_length(row[gx].ch);
+        }
 
-    uint8_t current_color = 255;
+        int forward = x - cursor_x;
+        int forward_length = forward == 1 ? CURSOR_FORWARD_LENGTH : CURSOR_FORWARD_LENGTH + number_length(forward);
+
+        if (gap_bytes <= forward_length && gap_bytes <= move_length)
+        {
+            int pos = 0;
+            for (int gx = cursor_x; gx < x; gx++)
+                pos += append_utf8(out + pos, row[gx].ch);
+            return pos;
+        }
+        if (forward_length < move_length)
+        {
+            int pos = append_bytes(out, "\033[", 2);
+            if (forward > 1)
+                pos += append_number(out + pos, forward);
+            out[pos++] = 'C';
+            return pos;
+        }
+    }
+
+    /* Line feed only moves down with output processing off */
+    if (x == 0 && cursor_y >= 0 && y == cursor_y + 1)
+        return append_bytes(out, "\r\n", 2);
+
+    return append_cursor_move(out, x, y);
+}
+
+/*
+ * Encode the frame row by row: all cells on a full redraw, otherwise only
+ * those that differ from the previously flushed frame. Runs of one repeated
+ * character become REP where the terminal has it, and once a row has nothing
+ * left but blanks the rest of it is erased with EL.
+ */
+static int flush_rows(TerminalBuffer *buf, char *output_buffer, Style *style, bool full)
+{
+    int pos = 0;
+
+    /* Terminal cursor position, -1 when unknown */
+    int cursor_x = -1;
+    int cursor_y = -1;
 
     /* Draw all lines except the very last one to prevent scrolling */
-    int safe_height = buf->height - 1; /* Render 0-22, skip line 23 */
+    int safe_height = buf->height - 1;
 
     for (int y = 0; y < safe_height; y++)
     {
-        /* Position cursor at start of line */
-        if (y > 0)
-            pos += sprintf(output_buffer + pos, "\033[%d;1H", y + 1);
+        /* On the last line drawn, stop before the last character to prevent scrolling */
+        int row_end = (y == safe_height - 1) ? buf->width - 1 : buf->width;
+        int row_index = y * buf->width;
+        const TerminalCell *row = &buf->buffer[row_index];
 
-        for (int x = 0; x < buf->width; x++)
+        /* Where the row's blank tail starts, found at its first change */
+        int blank_from = -1;
+        bool erase_tail = false;
+
+        int x = 0;
+        while (x < row_end)
         {
-            /* On line 22, stop before the last character to prevent scrolling */
-            if (y == safe_height - 1 && x == buf->width - 1)
-                break;
+            if (!full && !cell_changed(buf, row_index + x))
+            {
+                x++;
+                continue;
+            }
+
+            /* EL only pays off once it saves rewriting a few changed cells */
+            if (blank_from < 0)
+            {
+                blank_from = row_end;
+                while (blank_from > x && cell_blank(&row[blank_from - 1]))
+                    blank_from--;
 
-            int index = (y * buf->width + x) * 2;
-            char ch = buf->buffer[index];
-            uint8_t color = buf->buffer[index + 1];
+                int blank_changes = 0;
+                for (int bx = blank_from; bx < row_end && blank_changes < ERASE_LINE_LENGTH; bx++)
+                    blank_changes += full || cell_changed(buf, row_index + bx);
+                erase_tail = blank_changes >= ERASE_LINE_LENGTH;
+            }
+
+            pos += append_cursor_to(output_buffer + pos, buf, style, cursor_x, cursor_y, x, y);
+            cursor_x = x;
+            cursor_y = y;
+
+            if (erase_tail && x >= blank_from)
+            {
+                /* Erasing fills with the current background */
+                if (style->bg != TERM_COLOR_DEFAULT)
+                {
+                    Style target = {style->fg, TERM_COLOR_DEFAULT, style->attributes};
+                    pos += append_style(output_buffer + pos, style, &target, buf->truecolor);
+                }
+                pos += append_bytes(output_buffer + pos, "\033[K", ERASE_LINE_LENGTH);
+                break;
+            }
 
-            /* Only change color when needed */
-            if (color != current_color)
+            /* Emit the changed run */
+            while (x < row_end && (full || cell_changed(buf, row_index + x)) && !(erase_tail && x >= blank_from))
             {
-                pos += sprintf(output_buffer + pos, "\033[38;5;%dm", color);
-                current_color = color;
+                const TerminalCell *cell = &row[x];
+                pos += append_cell(output_buffer + pos, cell, style, buf->truecolor);
+                x++;
+
+                if (!buf->use_repeat)
+                    continue;
+
+                int repeat = 0;
+                while (x + repeat < row_end && !(erase_tail && x + repeat >= blank_from) &&
+                       row[x + repeat].ch == cell->ch && style_matches(style, &row[x + repeat]) &&
+                       (full || cell_changed(buf, row_index + x + repeat)))
+                    repeat++;
+
+                if (REPEAT_LENGTH + number_length(repeat) < repeat * utf8_length(cell->ch))
+                {
+                    pos += append_bytes(output_buffer + pos, "\033[", 2);
+                    pos += append_number(output_buffer + pos, repeat);
+                    output_buffer[pos++] = 'b';
+                    x += repeat;
+                }
             }
 
-            output_buffer[pos++] = ch;
+            /* Line wrapping is disabled, so the cursor sticks at the last column */
+            cursor_x = (x < buf->width) ? x : -1;
         }
     }
 
-    /* Reset color */
-    pos += sprintf(output_buffer + pos, "\033[0m");
+    return pos;
+}
+
+void terminal_buffer_flush(TerminalBuffer *buf)
+{
+    if (!buf || !buf->buffer || !buf->output)
+        return;
+
+    /* Use single write buffer to reduce flickering */
+    char *output_buffer = buf->output;
+    Style style = style_default;
+    int start = buf->synchronized_output ? SYNC_LENGTH : 0;
+    int pos;
+
+    /* Rows go after room for the begin-update sequence, which is only written if the frame has changes */
+    pos = flush_rows(buf, output_buffer + start, &style, !(buf->damage_tracking && buf->front_valid));
+
+    if (buf->damage_tracking)
+    {
+        memcpy(buf->front, buf->buffer, buf->width * buf->height * sizeof(TerminalCell));
+        buf->front_valid = true;
+    }
 
-    /* Single atomic write to reduce tearing */
-    write(STDOUT_FILENO, output_buffer, pos);
+    /* Nothing changed since the last frame */
+    if (pos == 0)
+    {
+        buf->flushed_bytes = 0;
+        return;
+    }
+
+    /* Leave the terminal in the default style the next flush starts from */
+    pos += start;
+    if (memcmp(&style, &style_default, sizeof(Style)) != 0)
+        pos += append_bytes(output_buffer + pos, RESET_SEQUENCE, RESET_SEQUENCE_LENGTH);
+
+    if (buf->synchronized_output)
+    {
+        append_bytes(output_buffer, SYNC_BEGIN, SYNC_LENGTH);
+        pos += append_bytes(output_buffer + pos, SYNC_END, SYNC_LENGTH);
+    }
+
+    buf->flushed_bytes = pos;
+
+    /* Single write to reduce tearing */
+    write_all(buf, output_buffer, pos);
+}
+
+void terminal_buffer_set_damage_tracking(TerminalBuffer *buf, bool enabled)
+{
+    if (!buf)
+        return;
+
+    buf->damage_tracking = enabled;
+    buf->front_valid = false;
+}
+
+void terminal_buffer_invalidate(TerminalBuffer *buf)
+{
+    if (buf)
+        buf->front_valid = false;
 }
 
 void terminal_hide_cursor(void)
@@ -3,18 +3,65 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
 
 #define TERM_MIN_WIDTH 80
 #define TERM_MIN_HEIGHT 24
 #define TERM_MAX_WIDTH 120
 #define TERM_MAX_HEIGHT 40
 
+/* Half-block drawing splits each cell into this many pixel rows */
+#define TERM_PIXELS_PER_CELL 2
+
+/* Block elements that draw the pixel rows of a cell */
+#define GLYPH_UPPER_HALF 0x2580
+#define GLYPH_LOWER_HALF 0x2584
+#define GLYPH_FULL_BLOCK 0x2588
+
+/*
+ * A color is 0xRRGGBB, a 256-color palette index tagged with
+ * TERM_COLOR_PALETTE, or TERM_COLOR_DEFAULT for the terminal's own color.
+ * RGB colors are sent as 24-bit escapes where the terminal supports them
+ * and mapped to the nearest palette entry elsewhere.
+ */
+typedef uint32_t TerminalColor;
+
+#define TERM_COLOR_PALETTE 0x01000000u
+#define TERM_COLOR_DEFAULT 0x02000000u
+#define TERM_PALETTE(index) (TERM_COLOR_PALETTE | (uint32_t)(index))
+#define TERM_RGB(r, g, b) (((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | (uint32_t)(b))
+
+/* Text attributes */
+#define TERM_ATTR_BOLD 0x1u
+#define TERM_ATTR_DIM 0x2u
+
+/* One character cell; 16 bytes with no padding, so cells compare with memcmp */
+typedef struct
+{
+    uint32_t ch; /* Unicode code point */
+    TerminalColor fg;
+    TerminalColor bg;
+    uint32_t attributes; /* TERM_ATTR_* */
+} TerminalCell;
+
 typedef struct
 {
-    char *buffer;
+    TerminalCell *buffer;
+    TerminalCell *front; /* Last frame written to the terminal, used for damage tracking; NULL if cells only */
+    char *output; /* Encoded frame, sized for the worst case at creation; NULL if cells only */
+    size_t output_capacity;
     int width;
     int height;
     bool cursor_visible;
+    int flushed_bytes; /* Bytes emitted by the last flush */
+    bool damage_tracking;
+    bool front_valid;
+    bool half_block;             /* Renderers draw small entities as half-cell pixels */
+    bool truecolor;              /* Send RGB colors as 24-bit escapes rather than palette approximations */
+    bool use_repeat;             /* Compress runs of one character with REP */
+    bool synchronized_output;    /* Bracket each frame in synchronized-update sequences */
+    atomic_bool write_cancelled; /* Set from another thread to make flushes stop writing */
 } TerminalBuffer;
 
 void terminal_init(void);
@@ -23,11 +70,18 @@ void terminal_get_size(int *width, int *height);
 bool terminal_validate_size(void);
 
 TerminalBuffer *terminal_buffer_create(int width, int height);
+TerminalBuffer *terminal_buffer_create_cells(int width, int height);
 void terminal_buffer_destroy(TerminalBuffer *buf);
 void terminal_buffer_clear(TerminalBuffer *buf);
-void terminal_buffer_set_char(TerminalBuffer *buf, int x, int y, char ch, uint8_t color);
-void terminal_buffer_set_string(TerminalBuffer *buf, int x, int y, const char *str, uint8_t color);
+void terminal_buffer_set_cell(TerminalBuffer *buf, int x, int y, TerminalCell cell);
+void terminal_buffer_set_char(TerminalBuffer *buf, int x, int y, char ch, TerminalColor color);
+void terminal_buffer_set_string(TerminalBuffer *buf, int x, int y, const char *str, TerminalColor color);
+void terminal_buffer_set_styled_string(TerminalBuffer *buf, int x, int y, const char *str, TerminalColor color,
+                                       uint32_t attributes);
+void terminal_buffer_set_pixel(TerminalBuffer *buf, int x, int pixel_y, TerminalColor color);
 void terminal_buffer_flush(TerminalBuffer *buf);
+void terminal_buffer_set_damage_tracking(TerminalBuffer *buf, bool enabled);
+void terminal_buffer_invalidate(TerminalBuffer *buf);
 
 void terminal_hide_cursor(void);
 void terminal_show_cursor(void);
@@ -36,17 +90,17 @@ void terminal_move_cursor(int x, int y);
 void terminal_set_color(uint8_t color);
 void terminal_reset_color(void);
 
-#define COLOR_BLACK 0
-#define COLOR_RED 196
-#define COLOR_GREEN 46
-#define COLOR_YELLOW 226
-#define COLOR_BLUE 21
-#define COLOR_MAGENTA 201
-#define COLOR_CYAN 51
-#define COLOR_WHITE 231
-#define COLOR_GRAY 240
-#define COLOR_ORANGE 208
-#define COLOR_PINK 213
-#define COLOR_PURPLE 93
+#define COLOR_BLACK TERM_PALETTE(0)
+#define COLOR_RED TERM_PALETTE(196)
+#define COLOR_GREEN TERM_PALETTE(46)
+#define COLOR_YELLOW TERM_PALETTE(226)
+#define COLOR_BLUE TERM_PALETTE(21)
+#define COLOR_MAGENTA TERM_PALETTE(201)
+#define COLOR_CYAN TERM_PALETTE(51)
+#define COLOR_WHITE TERM_PALETTE(231)
+#define COLOR_GRAY TERM_PALETTE(240)
+#define COLOR_ORANGE TERM_PALETTE(208)
+#define COLOR_PINK TERM_PALETTE(213)
+#define COLOR_PURPLE TERM_PALETTE(93)
 
 #endif
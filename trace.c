@@ -0,0 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#define TRACE_PID 1
+#define TRACE_MAIN_TID 1
+#define NANOSECONDS_PER_MICROSECOND 1000.0
+
+static FILE *trace_file = NULL;
+static uint64_t trace_start_ns = 0;
+static bool trace_first_event = true;
+static int trace_thread_count = TRACE_MAIN_TID;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER; /* Held while an event is written */
+
+/* Each thread's events go on a track of their own; threads start on the main one until they name themselves */
+static _Thread_local int trace_tid = TRACE_MAIN_TID;
+
+/* Monotonic clock in nanoseconds, the time base for trace_span */
+uint64_t trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Trace timestamps are microseconds since the trace was opened */
+static double trace_timestamp(uint64_t ns)
+{
+    return (double)(ns - trace_start_ns) / NANOSECONDS_PER_MICROSECOND;
+}
+
+static void trace_separator(void)
+{
+    if (!trace_first_event)
+        fputs(",\n", trace_file);
+    trace_first_event = false;
+}
+
+bool trace_open(const char *path)
+{
+    trace_file = fopen(path, "w");
+    if (!trace_file)
+        return false;
+
+    trace_start_ns = trace_now();
+    trace_first_event = true;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", trace_file);
+
+    trace_separator();
+    fprintf(trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"galaga\"}}",
+            TRACE_PID, TRACE_MAIN_TID);
+
+    trace_separator();
+    fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"game\"}}",
+            TRACE_PID, TRACE_MAIN_TID);
+    return true;
+}
+
+/* Put the calling thread's events on a new track with the given name */
+void trace_thread(const char *name)
+{
+    if (!trace_file)
+        return;
+
+    pthread_mutex_lock(&trace_lock);
+    trace_tid = ++trace_thread_count;
+    trace_separator();
+    fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            TRACE_PID, trace_tid, name);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+bool trace_close(void)
+{
+    if (!trace_file)
+        return true;
+
+    fputs("\n]}\n", trace_file);
+    bool ok = fclose(trace_file) == 0;
+    trace_file = NULL;
+    return ok;
+}
+
+bool trace_enabled(void)
+{
+    return trace_file != NULL;
+}
+
+/* A complete event covering [start_ns, end_ns) */
+void trace_span(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+    if (!trace_file)
+        return;
+
+    pthread_mutex_lock(&trace_lock);
+    trace_separator();
+    fprintf(trace_file,
+            "{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}", name,
+            trace_timestamp(start_ns), (end_ns - start_ns) / NANOSECONDS_PER_MICROSECOND, TRACE_PID, trace_tid);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+/* A global instant event at the current time, with one optional integer argument */
+void trace_instant(const char *name, const char *arg_name, long arg_value)
+{
+    if (!trace_file)
+        return;
+
+    pthread_mutex_lock(&trace_lock);
+    trace_separator();
+    fprintf(trace_file, "{\"name\":\"%s\",\"cat\":\"game\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+            name, trace_timestamp(trace_now()), TRACE_PID, trace_tid);
+    if (arg_name)
+        fprintf(trace_file, ",\"args\":{\"%s\":%ld}", arg_name, arg_value);
+    fputc('}', trace_file);
+    pthread_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,21 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Chrome/Perfetto trace-event JSON writer. There is one trace per process;
+ * every call is a no-op while no trace is open, so gameplay code can emit
+ * events unconditionally. Events may come from any thread while the trace
+ * is open; it must be opened and closed with no other thread running.
+ */
+bool trace_open(const char *path);
+bool trace_close(void);
+bool trace_enabled(void);
+uint64_t trace_now(void);
+void trace_thread(const char *name);
+void trace_span(const char *name, uint64_t start_ns, uint64_t end_ns);
+void trace_instant(const char *name, const char *arg_name, long arg_value);
+
+#endif